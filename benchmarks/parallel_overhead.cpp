@@ -0,0 +1,70 @@
+#include "parallel.h"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+/**
+ * Micro-benchmark for the per-call overhead of `run_parallel()`.
+ *
+ * We compare the persistent pool against the old approach of spawning a fresh set of `std::thread`s on each call.
+ * The workload is deliberately trivial so that the timings are dominated by thread startup and synchronization.
+ * Run with `node parallel_overhead.js [ncalls] [ntasks]` after building with `-DCOMPILE_BENCHMARKS=ON`.
+ */
+
+template<class Function>
+void run_parallel_spawned(int nworkers, int total, Function fun) {
+    int jobs_per_worker = std::ceil(static_cast<double>(total)/nworkers);
+    std::vector<std::thread> workers;
+    workers.reserve(nworkers);
+    int first = 0;
+
+    for (int w = 0; w < nworkers && first < total; ++w, first += jobs_per_worker) {
+        int last = std::min(first + jobs_per_worker, total);
+        workers.emplace_back(fun, first, last);
+    }
+
+    for (auto& wrk : workers) {
+        wrk.join();
+    }
+}
+
+template<class Runner>
+double time_per_call(int ncalls, int ntasks, Runner runner) {
+    std::vector<double> buffer(ntasks);
+    auto start = std::chrono::steady_clock::now();
+
+    for (int c = 0; c < ncalls; ++c) {
+        runner(ntasks, [&](int first, int last) -> void {
+            for (int i = first; i < last; ++i) {
+                buffer[i] += i;
+            }
+        });
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / ncalls;
+}
+
+int main(int argc, char** argv) {
+    int ncalls = (argc > 1 ? std::atoi(argv[1]) : 1000);
+    int ntasks = (argc > 2 ? std::atoi(argv[2]) : 10000);
+
+    // Timing the spawned version first, as the pool will hold on to all of
+    // the pre-allocated Web Workers once it is created.
+    int nthreads = find_num_threads();
+    std::cout << "threads: " << nthreads << ", calls: " << ncalls << ", tasks per call: " << ntasks << std::endl;
+
+    auto spawned = time_per_call(ncalls, ntasks, [&](int n, auto f) -> void { run_parallel_spawned(nthreads, n, f); });
+    std::cout << "spawned: " << spawned << " us/call" << std::endl;
+
+    // Creating the pool before timing, to avoid charging its startup to the first call.
+    ThreadPool::global();
+    auto pooled = time_per_call(ncalls, ntasks, [](int n, auto f) -> void { run_parallel(n, f); });
+    std::cout << "pooled:  " << pooled << " us/call" << std::endl;
+
+    return 0;
+}
@@ -10,6 +10,14 @@ then
     exit 1
 fi
 
+# Optional second argument to build with 64-bit memory.
+memory=${2:-wasm32}
+if [ $memory != "wasm32" ] && [ $memory != "wasm64" ]
+then
+    echo "second argument should be 'wasm32' or 'wasm64'"
+    exit 1
+fi
+
 # Copying over the Javascript files.
 destdir=$mode
 rm -rf ${destdir}
@@ -24,6 +32,16 @@ fi
 
 # Building the Wasm files.
 builddir=build_$mode
+if [ $memory == "wasm64" ]
+then
+    builddir=${builddir}_64
+    wasm64_flag=ON
+    hdf5_flag="-DHDF5_WASM64_SHA256=${HDF5_WASM64_SHA256:-}"
+else
+    wasm64_flag=OFF
+    hdf5_flag=
+fi
+
 if [ $mode == "main" ]
 then
     node_flag=ON
@@ -33,7 +51,7 @@ fi
 
 if [ ! -e $builddir ]
 then
-    emcmake cmake -S . -B $builddir -DCOMPILE_NODE=${node_flag} -DCMAKE_BUILD_TYPE=Release
+    emcmake cmake -S . -B $builddir -DCOMPILE_NODE=${node_flag} -DCOMPILE_WASM64=${wasm64_flag} ${hdf5_flag} -DCMAKE_BUILD_TYPE=Release
 fi
 
 cd $builddir
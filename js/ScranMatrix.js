@@ -122,6 +122,14 @@ export class ScranMatrix {
         return this.#matrix.sparse();
     }
 
+    /**
+     * @return {boolean} Whether the matrix (or any matrix it was derived from) reads its values from a file,
+     * see the `lazy` option in {@linkcode initializeSparseMatrixFromHDF5}.
+     */
+    isFileBacked() {
+        return this.#matrix.file_backed();
+    }
+
     /**
      * @return {boolean} Whether the ScranMatrix contains a non-trivial organization of row identities.
      * If `true`, the row identities can be extracted from {@linkcode ScranMatrix#identities identities};
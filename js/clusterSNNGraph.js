@@ -1,9 +1,10 @@
 import * as utils from "./utils.js";
 import * as gc from "./gc.js";
-import { FindNearestNeighborsResults, findNearestNeighbors } from "./findNearestNeighbors.js";
+import { FindNearestNeighborsResults } from "./findNearestNeighbors.js";
 
 /**
  * Wrapper around the SNN graph object on the Wasm heap, produced by {@linkcode buildSNNGraph}.
+ * The graph is stored in compressed sparse row format where each undirected edge is reported once, in the row of the endpoint with the larger index.
  * @hideconstructor
  */
 export class BuildSNNGraphResults {
@@ -16,6 +17,52 @@ export class BuildSNNGraphResults {
         return;
     }
 
+    /**
+     * @return {number} Number of cells, i.e., vertices in the graph.
+     */
+    numberOfCells() {
+        return this.#graph.num_cells();
+    }
+
+    /**
+     * @return {number} Number of undirected edges in the graph.
+     */
+    numberOfEdges() {
+        return this.#graph.num_edges();
+    }
+
+    /**
+     * @param {object} [options] - Optional parameters.
+     * @param {boolean|string} [options.copy=true] - Whether to copy the results from the Wasm heap, see {@linkcode possibleCopy}.
+     *
+     * @return {Uint32Array|Uint32WasmArray} Array of length equal to the number of cells plus 1.
+     * The edges for cell `i` are stored from `offsets[i]` to `offsets[i + 1]` in {@linkcode BuildSNNGraphResults#targets targets} and {@linkcode BuildSNNGraphResults#weights weights}.
+     */
+    offsets({ copy = true } = {}) {
+        return utils.possibleCopy(this.#graph.offsets(), copy);
+    }
+
+    /**
+     * @param {object} [options] - Optional parameters.
+     * @param {boolean|string} [options.copy=true] - Whether to copy the results from the Wasm heap, see {@linkcode possibleCopy}.
+     *
+     * @return {Uint32Array|Uint32WasmArray} Array of length equal to the number of edges, containing the index of the other endpoint of each edge.
+     * This is always less than the index of the cell in whose row the edge is stored.
+     */
+    targets({ copy = true } = {}) {
+        return utils.possibleCopy(this.#graph.targets(), copy);
+    }
+
+    /**
+     * @param {object} [options] - Optional parameters.
+     * @param {boolean|string} [options.copy=true] - Whether to copy the results from the Wasm heap, see {@linkcode possibleCopy}.
+     *
+     * @return {Float32Array|Float32WasmArray} Array of length equal to the number of edges, containing the weight of each edge.
+     */
+    weights({ copy = true } = {}) {
+        return utils.possibleCopy(this.#graph.weights(), copy);
+    }
+
     /**
      * @return Frees the memory allocated on the Wasm heap for this object.
      * This invalidates this object and all references to it.
@@ -47,12 +94,14 @@ export class BuildSNNGraphResults {
  * or the Jaccard index of the neighbor sets between cells (`"jaccard"`).
  * @param {number} [options.neighbors=10] - Number of nearest neighbors to use to construct the graph.
  * Ignored if `x` is a {@linkplain FindNearestNeighborsResults} object.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {BuildSNNGraphResults} Object containing the graph.
  */
-export function buildSNNGraph(x, { scheme = "rank", neighbors = 10 } = {}) {
+export function buildSNNGraph(x, { scheme = "rank", neighbors = 10, numberOfThreads = null } = {}) {
     var output;
-    var my_neighbors;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
 
     // Back compatibility.
     if (typeof scheme == "number") {
@@ -60,25 +109,22 @@ export function buildSNNGraph(x, { scheme = "rank", neighbors = 10 } = {}) {
     }
 
     try {
-        let ref;
         if (x instanceof FindNearestNeighborsResults) {
-            ref = x;
+            output = gc.call(
+                module => module.build_snn_graph(x.results, scheme, nthreads),
+                BuildSNNGraphResults
+            );
         } else {
-            my_neighbors = findNearestNeighbors(x, neighbors); 
-            ref = my_neighbors ; // separate assignment is necessary for only 'my_neighbors' but not 'x' to be freed.
+            // Searching and building in one go, to avoid holding all neighbor search results in memory.
+            output = gc.call(
+                module => module.build_snn_graph_from_index(x.index, neighbors, scheme, nthreads),
+                BuildSNNGraphResults
+            );
         }
 
-        output = gc.call(
-            module => module.build_snn_graph(ref.results, scheme),
-            BuildSNNGraphResults
-        );
-
     } catch(e) {
         utils.free(output);
         throw e;
-
-    } finally {
-        utils.free(my_neighbors);
     }
 
     return output;
@@ -147,6 +147,8 @@ export class FindNearestNeighborsResults {
      * to be used to store the indices of the neighbors of each cell.
      * @param {?Float64WasmArray} [options.distances=null] - A Wasm-allocated array of length equal to `size()`,
      * to be used to store the distances to the neighbors of each cell.
+     * @param {boolean|string} [options.copy=true] - Whether to copy the `indices` and `distances` from the Wasm heap, see {@linkcode possibleCopy}.
+     * Only used if `runs`, `indices` and `distances` are all `null`.
      *
      * @return {object} 
      * An object is returned with the `runs`, `indices` and `distances` keys, each with an appropriate TypedArray as the value.
@@ -154,39 +156,32 @@ export class FindNearestNeighborsResults {
      * If all of the arguments are non-`null`, the TypedArrays in the returned object are views on the corresponding input WasmArrays.
      * Note that these views may be invalidated on the next allocation on the Wasm heap.
      *
+     * If all of the arguments are `null`, `indices` and `distances` are taken directly from the search results according to `copy`.
+     * This avoids any intermediate allocations on the Wasm heap.
+     *
      * If only some of the arguments are non-`null`, an error is raised.
      */
-    serialize({ runs = null, indices = null, distances = null } = {}) {
-        var copy = (runs === null) + (indices === null) + (distances === null);
-        if (copy != 3 && copy != 0) {
+    serialize({ runs = null, indices = null, distances = null, copy = true } = {}) {
+        var nulls = (runs === null) + (indices === null) + (distances === null);
+        if (nulls != 3 && nulls != 0) {
             throw new Error("either all or none of 'runs', 'indices' and 'distances' can be 'null'");
         }
 
         var output;
 
-        if (copy === 3) {
-            var run_data;
-            var ind_data;
-            var dist_data;
-            
-            try {
-                run_data = utils.createInt32WasmArray(this.numberOfCells());
-                let s = this.size();
-                ind_data = utils.createInt32WasmArray(s);
-                dist_data = utils.createFloat64WasmArray(s);
-                this.#results.serialize(run_data.offset, ind_data.offset, dist_data.offset);
-
-                output = { 
-                    "runs": run_data.slice(), 
-                    "indices": ind_data.slice(), 
-                    "distances": dist_data.slice() 
-                };
-            } finally {
-                utils.free(run_data);
-                utils.free(ind_data);
-                utils.free(dist_data);
+        if (nulls === 3) {
+            let offsets = this.#results.offsets();
+            let run_data = new Int32Array(offsets.length - 1);
+            for (var i = 0; i < run_data.length; i++) {
+                run_data[i] = offsets[i + 1] - offsets[i];
             }
 
+            output = { 
+                "runs": run_data,
+                "indices": utils.possibleCopy(this.#results.indices(), copy),
+                "distances": utils.possibleCopy(this.#results.distances(), copy)
+            };
+
         } else {
             this.#results.serialize(runs.offset, indices.offset, distances.offset);
             output = {
@@ -255,12 +250,16 @@ export class FindNearestNeighborsResults {
  *
  * @param {NeighborSearchIndex} x The neighbor search index built by {@linkcode buildNeighborSearchIndex}.
  * @param {number} k Number of neighbors to find.
+ * @param {object} [options] - Optional parameters.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {FindNearestNeighborsResults} Object containing the search results.
  */
-export function findNearestNeighbors(x, k) {
+export function findNearestNeighbors(x, k, { numberOfThreads = null } = {}) {
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
     return gc.call(
-        module => module.find_nearest_neighbors(x.index, k),
+        module => module.find_nearest_neighbors(x.index, k, nthreads),
         FindNearestNeighborsResults
     );
 }
@@ -1,5 +1,6 @@
 import * as utils from "./utils.js";
 import * as wasm from "./wasm.js";
+import * as wa from "wasmarrays.js";
 
 function unpack_strings(buffer, lengths) {
     let dec = new TextDecoder();
@@ -73,16 +74,45 @@ function check_shape(x, shape) {
     return x;
 }
 
+function is_file_image(file) {
+    if (typeof file == "string") {
+        return false;
+    }
+    if (!(file instanceof wa.Uint8WasmArray && file.space === wasm.wasmArraySpace())) {
+        throw new Error("'file' should be a string or a Uint8WasmArray on the scran.js Wasm heap");
+    }
+    return true;
+}
+
+function open_object(file, name, cls) {
+    if (is_file_image(file)) {
+        return wasm.call(module => new module[cls](file.offset, file.length, name));
+    } else {
+        return wasm.call(module => new module[cls](file, name));
+    }
+}
+
+function check_writable(file) {
+    if (is_file_image(file)) {
+        throw new Error("cannot write to a HDF5 file that was loaded into memory");
+    }
+}
 
 /**
  * Base class for HDF5 objects.
+ *
+ * Objects can be read from a HDF5 file on the (virtual) filesystem or from the contents of a HDF5 file in a Uint8WasmArray.
+ * The latter is useful in browsers, where the contents of an uploaded file can be copied directly to the Wasm heap
+ * and then read by the HDF5 library without creating another copy on the virtual filesystem.
+ * In such cases, the Uint8WasmArray should not be freed while any objects from this file are still in use,
+ * and the file cannot be modified.
  */
 export class H5Base {
     #file;
     #name;
 
     /**
-     * @param {string} file - Path to the HDF5 file.
+     * @param {(string|Uint8WasmArray)} file - Path to the HDF5 file, or the contents of the file on the Wasm heap, see {@linkplain H5Base}.
      * @param {string} name - Name of the object inside the file.
      */
     constructor(file, name) {
@@ -91,8 +121,8 @@ export class H5Base {
     }
 
     /**
-     * @member {string}
-     * @desc Path to the HDF5 file.
+     * @member {(string|Uint8WasmArray)}
+     * @desc Path to the HDF5 file, or the contents of the file on the Wasm heap.
      */
     get file() {
         return this.#file;
@@ -116,7 +146,7 @@ export class H5Group extends H5Base {
     #children;
 
     /**
-     * @param {string} file - Path to the HDF5 file.
+     * @param {(string|Uint8WasmArray)} file - Path to the HDF5 file, or the contents of the file on the Wasm heap, see {@linkplain H5Base}.
      * @param {string} name - Name of the object inside the file.
      * @param {object} [options] - Optional parameters.
      * @param {object} [options.children=null] - For internal use, to set the immediate children of this group.
@@ -126,7 +156,7 @@ export class H5Group extends H5Base {
         super(file, name);
 
         if (children === null) {
-            let x = wasm.call(module => new module.H5GroupDetails(file, name));
+            let x = open_object(file, name, "H5GroupDetails");
             try {
                 let child_names = unpack_strings(x.buffer(), x.lengths());
                 let child_types = x.types();
@@ -191,6 +221,7 @@ export class H5Group extends H5Base {
      * If a group already exists at `name`, it is returned directly.
      */
     createGroup(name) {
+        check_writable(this.file);
         let new_name = this.#child_name(name);
         if (name in this.children) {
             if (this.children[name] == "Group") {
@@ -225,6 +256,7 @@ export class H5Group extends H5Base {
      * A {@linkplain H5DataSet} object is returned representing this new dataset.
      */
     createDataSet(name, type, shape, { maxStringLength = 10, compression = 6, chunks = null } = {}) {
+        check_writable(this.file);
         let new_name = this.#child_name(name);
 
         let shape_arr;
@@ -323,7 +355,7 @@ export class H5Group extends H5Base {
  */
 export class H5File extends H5Group {
     /**
-     * @param {string} file - Path to the HDF5 file.
+     * @param {(string|Uint8WasmArray)} file - Path to the HDF5 file, or the contents of the file on the Wasm heap, see {@linkplain H5Base}.
      * @param {object} [options] - Optional parameters.
      * @param {object} [options.children=null] - For internal use, to set the immediate children of the file.
      * If `null`, this is determined by reading the `file`.
@@ -362,7 +394,7 @@ export class H5DataSet extends H5Base {
         let type;
         let shape;
 
-        let x = wasm.call(module => new module.LoadedH5DataSet(file, name));
+        let x = open_object(file, name, "LoadedH5DataSet");
         try {
             type = x.type();
             if (type == "other") {
@@ -384,7 +416,7 @@ export class H5DataSet extends H5Base {
     }
 
     /**
-     * @param {string} file - Path to the HDF5 file.
+     * @param {(string|Uint8WasmArray)} file - Path to the HDF5 file, or the contents of the file on the Wasm heap, see {@linkplain H5Base}.
      * @param {string} name - Name of the object inside the file.
      * @param {object} [options] - Optional parameters.
      * @param {boolean} [options.load=false] - Whether or not to load the contents of the dataset in the constructor.
@@ -400,7 +432,7 @@ export class H5DataSet extends H5Base {
 
         if (shape === null && type === null) {
             if (!load) {
-                let x = wasm.call(module => new module.H5DataSetDetails(file, name));
+                let x = open_object(file, name, "H5DataSetDetails");
                 try {
                     this.#type = x.type();
                     this.#shape = Array.from(x.shape());
@@ -486,6 +518,7 @@ export class H5DataSet extends H5Base {
      * No return value is provided.
      */
     write(x, { cache = false } = {}) {
+        check_writable(this.file);
         if (x === null) {
             throw new Error("cannot write 'null' to HDF5"); 
         }
@@ -564,8 +597,9 @@ function extract_names(host, output, recursive = true) {
 /**
  * Extract object names from a HDF5 file.
  *
- * @param {string} path - Path to a HDF5 file.
+ * @param {(string|Uint8WasmArray)} path - Path to a HDF5 file.
  * For web applications, this should be saved to the virtual filesystem with {@linkcode writeFile}.
+ * Alternatively, the contents of the file can be supplied directly in a Uint8WasmArray, see {@linkplain H5Base}.
  * @param {object} [options] - Optional parameters.
  * @param {string} [options.group=""] - Group to use as the root of the search.
  * If an empty string is supplied, the entire file is used as the root.
@@ -591,8 +625,9 @@ export function extractHDF5ObjectNames (path, { group = "", recursive = true } =
 /**
  * Load a dataset from a HDF5 file.
  *
- * @param {string} path - Path to a HDF5 file.
+ * @param {(string|Uint8WasmArray)} path - Path to a HDF5 file.
  * For web applications, this should be saved to the virtual filesystem with {@linkcode writeFile}.
+ * Alternatively, the contents of the file can be supplied directly in a Uint8WasmArray, see {@linkplain H5Base}.
  * @param {string} name - Name of a dataset inside the HDF5 file.
  * 
  * @return {object} An object containing:
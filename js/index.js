@@ -1,8 +1,10 @@
-export { initialize, terminate, wasmArraySpace, heapSize, writeFile, removeFile, fileExists, readFile } from "./wasm.js";
+export { initialize, terminate, wasmArraySpace, maximumThreads, isWasm64, heapSize, writeFile, removeFile, fileExists, readFile } from "./wasm.js";
 export { createUint8WasmArray, createInt32WasmArray, createFloat64WasmArray, free, safeFree } from "./utils.js";
 
 export * from "./initializeSparseMatrix.js";
+export * from "./saveScranMatrix.js";
 export * from "./hdf5.js";
+export * from "./writeSparseMatrixToHDF5.js";
 
 export * from "./permute.js";
 export * from "./guessFeatures.js";
@@ -2,6 +2,9 @@ import * as gc from "./gc.js";
 import * as wasm from "./wasm.js";
 import * as utils from "./utils.js"; 
 import { ScranMatrix } from "./ScranMatrix.js";
+import { MultiMatrix } from "./MultiMatrix.js";
+import { loadFromPathOrBuffer } from "./internal/loadFromPathOrBuffer.js";
+import * as wa from "wasmarrays.js";
 
 /**
  * Initialize a sparse matrix from its compressed components.
@@ -10,12 +13,16 @@ import { ScranMatrix } from "./ScranMatrix.js";
  * @param {number} numberOfColumns Number of columns in the matrix.
  * @param {WasmArray|Array|TypedArray} values Values of all elements in the matrix, stored in column-major order.
  * These should all be non-negative integers, even if they are stored in floating-point.
+ * @param {object} [options] - Optional parameters.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {ScranMatrix} A layered sparse matrix.
  */
-export function initializeSparseMatrixFromDenseArray(numberOfRows, numberOfColumns, values) {
+export function initializeSparseMatrixFromDenseArray(numberOfRows, numberOfColumns, values, { numberOfThreads = null } = {}) {
     var val_data; 
     var output;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
 
     try {
         val_data = utils.wasmifyArray(values, null);
@@ -28,7 +35,8 @@ export function initializeSparseMatrixFromDenseArray(numberOfRows, numberOfColum
                 numberOfRows, 
                 numberOfColumns, 
                 val_data.offset, 
-                val_data.constructor.className.replace("Wasm", "")
+                val_data.constructor.className.replace("Wasm", ""),
+                nthreads
             ),
             ScranMatrix
         );
@@ -50,7 +58,7 @@ export function initializeSparseMatrixFromDenseArray(numberOfRows, numberOfColum
  * @param {number} numberOfRows Number of rows in the matrix.
  * @param {number} numberOfColumns Number of columns in the matrix.
  * @param {WasmArray} values Values of the non-zero elements.
- * These should all be non-negative integers, even if they are stored in floating-point.
+ * These should all be non-negative integers, even if they are stored in floating-point, unless `layered = false`.
  * @param {WasmArray} indices Row indices of the non-zero elements.
  * This should be of the same length as `values`.
  * @param {WasmArray} pointers Pointers specifying the start of each column in `indices`.
@@ -58,14 +66,23 @@ export function initializeSparseMatrixFromDenseArray(numberOfRows, numberOfColum
  * @param {object} [options] - Optional parameters.
  * @param {boolean} [options.byColumn=true] - Whether the supplied arrays refer to the compressed sparse column format.
  * If `true`, `indices` should contain column indices and `pointers` should specify the start of each row in `indices`.
+ * @param {boolean} [options.layered=true] - Whether to create a layered sparse matrix, where values are stored in the smallest integer type that fits.
+ * This requires all `values` to be non-negative integers.
+ * If `false`, the values are stored as-is, which is appropriate for non-integer data like normalized expression values.
+ * @param {boolean} [options.float32=false] - Whether to store the values in single precision when `layered = false`.
+ * This halves the memory usage of the values at the cost of some precision.
+ * Downstream functions still compute in double precision, converting one row or column at a time.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
- * @return {ScranMatrix} A layered sparse matrix.
+ * @return {ScranMatrix} A sparse matrix, layered if `layered = true`.
  */ 
-export function initializeSparseMatrixFromCompressedVectors(numberOfRows, numberOfColumns, values, indices, pointers, { byColumn = true } = {}) {
+export function initializeSparseMatrixFromCompressedVectors(numberOfRows, numberOfColumns, values, indices, pointers, { byColumn = true, layered = true, float32 = false, numberOfThreads = null } = {}) {
     var val_data;
     var ind_data;
     var indp_data;
     var output;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
 
     try {
         val_data = utils.wasmifyArray(values, null);
@@ -89,7 +106,10 @@ export function initializeSparseMatrixFromCompressedVectors(numberOfRows, number
                 ind_data.constructor.className.replace("Wasm", ""), 
                 indp_data.offset, 
                 indp_data.constructor.className.replace("Wasm", ""), 
-                byColumn 
+                byColumn,
+                layered,
+                float32,
+                nthreads
             ),
             ScranMatrix
         );
@@ -118,37 +138,20 @@ export function initializeSparseMatrixFromCompressedVectors(numberOfRows, number
  * @param {object} [options] - Optional parameters.
  * @param {boolean} [options.compressed=null] - Whether the buffer is Gzip-compressed.
  * If `null`, we detect this automatically from the magic number in the header.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {ScranMatrix} A layered sparse matrix.
  */
-export function initializeSparseMatrixFromMatrixMarket(x, { compressed = null } = {}) {
-    var buf_data;
-    var output;
-
-    try {
-        compressed = convert_compressed(compressed);
-        if (typeof x !== "string") {
-            buf_data = utils.wasmifyArray(x, "Uint8WasmArray");
-            output = gc.call(
-                module => module.read_matrix_market_from_buffer(buf_data.offset, buf_data.length, compressed),
-                ScranMatrix
-            );
-        } else {
-            output = gc.call(
-                module => module.read_matrix_market_from_file(x, compressed),
-                ScranMatrix
-            );
-        }
-
-    } catch(e) {
-        utils.free(output);
-        throw e;
-
-    } finally {
-        utils.free(buf_data);
-    }
-
-    return output;
+export function initializeSparseMatrixFromMatrixMarket(x, { compressed = null, numberOfThreads = null } = {}) {
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+    compressed = convert_compressed(compressed);
+    return loadFromPathOrBuffer(
+        x,
+        (module, offset, length) => module.read_matrix_market_from_buffer(offset, length, compressed, nthreads),
+        (module, path) => module.read_matrix_market_from_file(path, compressed, nthreads),
+        ScranMatrix
+    );
 }
 
 function convert_compressed(compressed) {
@@ -162,8 +165,8 @@ function convert_compressed(compressed) {
 }
 
 // For back-compatibility, deprecated as of 0.3.0.
-export function initializeSparseMatrixFromMatrixMarketBuffer(x, { compressed = null } = {}) {
-    return initializeSparseMatrixFromMatrixMarket(x, { compressed: compressed });
+export function initializeSparseMatrixFromMatrixMarketBuffer(x, { compressed = null, numberOfThreads = null } = {}) {
+    return initializeSparseMatrixFromMatrixMarket(x, { compressed: compressed, numberOfThreads: numberOfThreads });
 }
 
 /** 
@@ -207,22 +210,438 @@ export function extractMatrixMarketDimensions(x, { compressed = null } = {}) {
     return output;
 }
 
+/**
+ * Incremental reader for a Matrix Market file, typically created by {@linkcode createMatrixMarketReader}.
+ * This allows the file to be parsed in chunks as they become available, e.g., from a network request or a file upload,
+ * without holding the entire (compressed or uncompressed) file in memory.
+ * @hideconstructor
+ */
+export class MatrixMarketReader {
+    #id;
+    #reader;
+    #buffer;
+
+    constructor(id, raw) {
+        this.#id = id;
+        this.#reader = raw;
+        this.#buffer = null;
+        return;
+    }
+
+    /**
+     * @param {Uint8WasmArray|Array|TypedArray|ArrayBuffer} chunk - Next chunk of the Matrix Market file.
+     * Chunks should be supplied in the same order as they occur in the file, but can be split at any position.
+     *
+     * @return The contents of `chunk` are parsed (after decompression, if necessary).
+     * No return value is provided.
+     */
+    add(chunk) {
+        if (this.#reader === null) {
+            throw new Error("cannot add chunks after calling 'finish()'");
+        }
+
+        if (chunk instanceof wa.Uint8WasmArray && chunk.space === wasm.wasmArraySpace()) {
+            wasm.call(module => this.#reader.add(chunk.offset, chunk.length));
+            return;
+        }
+
+        if (chunk instanceof ArrayBuffer) {
+            chunk = new Uint8Array(chunk);
+        }
+
+        // Re-using the same buffer for each chunk, so that only one chunk is on the Wasm heap at any time.
+        if (this.#buffer === null || this.#buffer.length < chunk.length) {
+            utils.free(this.#buffer);
+            this.#buffer = null;
+            this.#buffer = utils.createUint8WasmArray(chunk.length);
+        }
+        this.#buffer.array().set(chunk);
+        wasm.call(module => this.#reader.add(this.#buffer.offset, chunk.length));
+        return;
+    }
+
+    /**
+     * @return {ScranMatrix} A layered sparse matrix containing the contents of the file.
+     * This reader is freed and cannot be used for further chunks.
+     */
+    finish() {
+        if (this.#reader === null) {
+            throw new Error("'finish()' has already been called");
+        }
+
+        let output;
+        try {
+            output = gc.call(module => this.#reader.finish(), ScranMatrix);
+        } finally {
+            this.free();
+        }
+
+        return output;
+    }
+
+    /**
+     * @return Frees the memory allocated on the Wasm heap for this object.
+     * This invalidates this object and all references to it.
+     */
+    free() {
+        if (this.#reader !== null) {
+            gc.release(this.#id);
+            this.#reader = null;
+        }
+        utils.free(this.#buffer);
+        this.#buffer = null;
+        return;
+    }
+}
+
+/**
+ * Create a reader to parse a Matrix Market file in chunks.
+ * The peak memory usage is determined by the parsed contents and the size of each chunk, rather than the size of the file.
+ * Parsed entries take 8-10 bytes each until {@linkcode MatrixMarketReader#finish finish} is called.
+ * The layered sparse matrix (3-4 bytes per entry) is then constructed while most of the parsed entries are still held,
+ * so the peak memory usage is roughly 11-14 bytes per non-zero entry.
+ *
+ * @param {object} [options] - Optional parameters.
+ * @param {boolean} [options.compressed=null] - Whether the file is Gzip-compressed.
+ * If `null`, we detect this automatically from the magic number in the header.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {MatrixMarketReader} A reader to which chunks of the file can be supplied with {@linkcode MatrixMarketReader#add add}.
+ * Once all chunks have been supplied, the matrix can be created with {@linkcode MatrixMarketReader#finish finish}.
+ */
+export function createMatrixMarketReader({ compressed = null, numberOfThreads = null } = {}) {
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+    return gc.call(
+        module => new module.MatrixMarketReader(convert_compressed(compressed), nthreads),
+        MatrixMarketReader
+    );
+}
+
+/**
+ * Initialize a layered sparse matrix from a stream of chunks of a Matrix Market file.
+ *
+ * @param {ReadableStream|AsyncIterable} stream - Stream of the contents of a Matrix Market file, e.g., from `fetch()` or `File.stream()` in browsers.
+ * Each chunk should be a Uint8Array or ArrayBuffer.
+ * Alternatively, any asynchronous iterable can be supplied, e.g., `fs.createReadStream()` in Node.js.
+ * @param {object} [options] - Optional parameters.
+ * @param {boolean} [options.compressed=null] - Whether the file is Gzip-compressed.
+ * If `null`, we detect this automatically from the magic number in the header.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {ScranMatrix} A layered sparse matrix, equivalent to that from {@linkcode initializeSparseMatrixFromMatrixMarket}.
+ * Each chunk is parsed as it is received, see {@linkcode createMatrixMarketReader} for details.
+ */
+export async function initializeSparseMatrixFromMatrixMarketStream(stream, { compressed = null, numberOfThreads = null } = {}) {
+    let reader = createMatrixMarketReader({ compressed: compressed, numberOfThreads: numberOfThreads });
+
+    try {
+        if (Symbol.asyncIterator in stream) {
+            for await (const chunk of stream) {
+                reader.add(chunk);
+            }
+        } else {
+            let sreader = stream.getReader();
+            while (true) {
+                const { done, value } = await sreader.read();
+                if (done) {
+                    break;
+                }
+                reader.add(value);
+            }
+        }
+        return reader.finish();
+
+    } finally {
+        reader.free();
+    }
+}
+
 /**
  * Initialize a layered sparse matrix from a HDF5 file.
  *
- * @param {string} file Path to the HDF5 file.
+ * @param {(string|Uint8Array|ArrayBuffer|Uint8WasmArray)} file Path to the HDF5 file.
  * For web contexts, this should be saved to the virtual filesystem.
+ * Alternatively, the contents of the file can be supplied directly, in which case they are read in memory without creating a copy on the virtual filesystem.
+ * A Uint8WasmArray on the Wasm heap is used without any copies and can be freed once this function returns;
+ * other arrays are copied to the Wasm heap.
  * @param {string} name Name of the dataset inside the file.
  * This can be a HDF5 Dataset for dense matrices or a HDF5 Group for sparse matrices.
  * For the latter, both H5AD and 10X-style sparse formats are supported.
+ * @param {object} [options] - Optional parameters.
+ * @param {boolean} [options.lazy=false] - Whether to read values from the file on demand instead of loading the entire matrix into memory.
+ * This allows the analysis of matrices that are larger than the Wasm heap, at the cost of speed.
+ * If `true`, `file` must not be removed before the returned matrix (and any of its derivatives) are freed.
+ * This is not supported if `file` contains the contents of the file instead of a path.
+ * All computations involving a lazy matrix are performed on a single thread, as the HDF5 library is not thread-safe.
+ * @param {number} [options.cacheSize=100000000] - Size of the cache in bytes, used to hold blocks of rows or columns that were read from the file.
+ * Larger caches reduce the number of reads at the cost of memory usage.
+ * Only used if `lazy = true`.
+ * @param {?(Array|TypedArray|Int32WasmArray)} [options.subsetRow=null] - Row indices to load, e.g., for a panel of genes.
+ * Indices should be unique and refer to rows in the file.
+ * If `null`, all rows are loaded.
+ * @param {?(Array|TypedArray|Int32WasmArray)} [options.subsetColumn=null] - Column indices to load, e.g., for cells that passed an upstream filter.
+ * Indices should refer to columns in the file.
+ * If `lazy = false` and the rows are the primary dimension of a compressed sparse matrix (e.g., a H5AD group with a `csc_matrix` encoding),
+ * indices should also be unique, as each non-zero element in a row can only be assigned to one column.
+ * If `null`, all columns are loaded.
+ * @param {number} [options.chunkCacheSize=16000000] - Size of the HDF5 chunk cache for each dataset, in bytes.
+ * This holds decompressed chunks that are shared between consecutive reads.
+ * Only used if `lazy = false`.
+ * @param {number} [options.blockSize=16000000] - Maximum size of each read from the file, in bytes.
+ * Reads are aligned to the chunk boundaries of each dataset,
+ * so larger blocks reduce the number of reads (which is helpful for remote-mounted files) at the cost of memory usage.
+ * Only used if `lazy = false`.
+ * @param {boolean} [options.directChunkRead=true] - Whether to read compressed chunks directly from the file and decompress them in parallel.
+ * This is only used for datasets that are compressed with DEFLATE (and optionally the shuffle filter); other datasets are read through the HDF5 library as usual.
+ * Only used if `lazy = false`.
+ * @param {?object} [options.statistics=null] - Object in which to store statistics about the reads, for tuning `chunkCacheSize` and `blockSize`.
+ * If supplied and `lazy = false`, the `bytesRead` property is set to the number of bytes read from the datasets,
+ * and the `readCalls` property is set to the number of read requests to the HDF5 library.
+ * For regular reads, the number of bytes refers to the uncompressed size of the data; for direct chunk reads, it refers to the compressed size.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * Decompression is performed in parallel when `directChunkRead = true`.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
- * @return {ScranMatrix} A layered sparse matrix.
+ * @return {ScranMatrix} A layered sparse matrix if `lazy = false`, otherwise a file-backed matrix.
+ * If `subsetRow` is supplied, the row identities refer to the rows in the file, see {@linkcode ScranMatrix#identities identities}.
+ *
+ * If `lazy = false`, only the requested rows and columns are read from the file,
+ * which avoids loading the entire matrix when only a small subset is of interest.
  */
-export function initializeSparseMatrixFromHDF5(file, name) {
-    return gc.call(
-        module => module.read_hdf5_matrix(file, name),
-        ScranMatrix
-    );
+export function initializeSparseMatrixFromHDF5(file, name, { 
+    lazy = false, 
+    cacheSize = 100000000, 
+    subsetRow = null, 
+    subsetColumn = null, 
+    chunkCacheSize = 16000000, 
+    blockSize = 16000000, 
+    directChunkRead = true,
+    statistics = null,
+    numberOfThreads = null
+} = {}) {
+    var row_data;
+    var col_data;
+    var image;
+    var stats;
+    var output;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+
+    let in_memory = (typeof file !== "string");
+    if (in_memory && lazy) {
+        throw new Error("'lazy = true' is not supported when 'file' contains the contents of a HDF5 file");
+    }
+
+    try {
+        stats = utils.createFloat64WasmArray(2);
+
+        if (in_memory) {
+            if (file instanceof ArrayBuffer) {
+                file = new Uint8Array(file);
+            }
+            image = utils.wasmifyArray(file, "Uint8WasmArray");
+        }
+
+        let use_row = (subsetRow !== null);
+        if (use_row) {
+            row_data = utils.wasmifyArray(subsetRow, "Int32WasmArray");
+        }
+
+        let use_col = (subsetColumn !== null);
+        if (use_col) {
+            col_data = utils.wasmifyArray(subsetColumn, "Int32WasmArray");
+        }
+
+        if (in_memory) {
+            output = gc.call(
+                module => module.read_hdf5_matrix_from_buffer(
+                    image.offset,
+                    image.length,
+                    name, 
+                    use_row,
+                    (use_row ? row_data.offset : 0),
+                    (use_row ? row_data.length : 0),
+                    use_col,
+                    (use_col ? col_data.offset : 0),
+                    (use_col ? col_data.length : 0),
+                    chunkCacheSize,
+                    blockSize,
+                    directChunkRead,
+                    stats.offset,
+                    nthreads
+                ),
+                ScranMatrix
+            );
+        } else {
+            output = gc.call(
+                module => module.read_hdf5_matrix(
+                    file, 
+                    name, 
+                    lazy, 
+                    cacheSize,
+                    use_row,
+                    (use_row ? row_data.offset : 0),
+                    (use_row ? row_data.length : 0),
+                    use_col,
+                    (use_col ? col_data.offset : 0),
+                    (use_col ? col_data.length : 0),
+                    chunkCacheSize,
+                    blockSize,
+                    directChunkRead,
+                    stats.offset,
+                    nthreads
+                ),
+                ScranMatrix
+            );
+        }
+
+        if (statistics !== null && !lazy) {
+            let sarr = stats.array();
+            statistics.bytesRead = sarr[0];
+            statistics.readCalls = sarr[1];
+        }
+
+    } catch (e) {
+        utils.free(output);
+        throw e;
+
+    } finally {
+        utils.free(row_data);
+        utils.free(col_data);
+        utils.free(image);
+        utils.free(stats);
+    }
+
+    return output;
+}
+
+/**
+ * Initialize separate layered sparse matrices for different modalities from a HDF5 file, e.g., for CITE-seq data where gene expression and antibody capture features are stored in the same matrix.
+ * This reads the file only once and distributes the non-zero elements of each row to the matrix for its modality,
+ * which is faster and uses less memory than loading the combined matrix with {@linkcode initializeSparseMatrixFromHDF5} and subsetting it for each modality.
+ *
+ * @param {(string|Uint8Array|ArrayBuffer|Uint8WasmArray)} file Path to the HDF5 file, or the contents of the file, see {@linkcode initializeSparseMatrixFromHDF5}.
+ * @param {string} name Name of the dataset (for dense matrices) or group (for sparse matrices) inside the file.
+ * @param {Array} modalities - Array of length equal to the number of rows in the file, containing the modality of each row, e.g., from the `features/feature_type` dataset of a 10X HDF5 file.
+ * Rows with `null` modalities are not loaded.
+ * @param {object} [options] - Optional parameters.
+ * @param {?(Array|TypedArray|Int32WasmArray)} [options.subsetColumn=null] - Column indices to load, see {@linkcode initializeSparseMatrixFromHDF5}.
+ * @param {number} [options.chunkCacheSize=16000000] - Size of the HDF5 chunk cache for each dataset, in bytes.
+ * @param {number} [options.blockSize=16000000] - Maximum size of each read from the file, in bytes.
+ * @param {boolean} [options.directChunkRead=true] - Whether to read compressed chunks directly from the file and decompress them in parallel.
+ * @param {?object} [options.statistics=null] - Object in which to store statistics about the reads, see {@linkcode initializeSparseMatrixFromHDF5}.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {MultiMatrix} A MultiMatrix containing a layered sparse matrix for each unique modality in `modalities`.
+ * The row identities of each matrix refer to the rows in the file, see {@linkcode ScranMatrix#identities identities}.
+ */
+export function initializeMultiMatrixFromHDF5(file, name, modalities, { 
+    subsetColumn = null, 
+    chunkCacheSize = 16000000, 
+    blockSize = 16000000, 
+    directChunkRead = true,
+    statistics = null,
+    numberOfThreads = null
+} = {}) {
+    var mod_data;
+    var col_data;
+    var image;
+    var stats;
+    var raw;
+    var output = new MultiMatrix();
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+
+    try {
+        // Converting the modalities into integer codes in order of their first appearance.
+        let levels = [];
+        let mapping = new Map();
+        mod_data = utils.createInt32WasmArray(modalities.length);
+        let mod_arr = mod_data.array();
+        modalities.forEach((x, i) => {
+            if (x === null) {
+                mod_arr[i] = -1;
+            } else {
+                if (!mapping.has(x)) {
+                    mapping.set(x, levels.length);
+                    levels.push(x);
+                }
+                mod_arr[i] = mapping.get(x);
+            }
+        });
+
+        stats = utils.createFloat64WasmArray(2);
+
+        let use_col = (subsetColumn !== null);
+        if (use_col) {
+            col_data = utils.wasmifyArray(subsetColumn, "Int32WasmArray");
+        }
+
+        if (typeof file !== "string") {
+            if (file instanceof ArrayBuffer) {
+                file = new Uint8Array(file);
+            }
+            image = utils.wasmifyArray(file, "Uint8WasmArray");
+            raw = wasm.call(module => module.read_hdf5_matrix_split_from_buffer(
+                image.offset,
+                image.length,
+                name,
+                mod_data.offset,
+                mod_data.length,
+                levels.length,
+                use_col,
+                (use_col ? col_data.offset : 0),
+                (use_col ? col_data.length : 0),
+                chunkCacheSize,
+                blockSize,
+                directChunkRead,
+                stats.offset,
+                nthreads
+            ));
+        } else {
+            raw = wasm.call(module => module.read_hdf5_matrix_split(
+                file,
+                name,
+                mod_data.offset,
+                mod_data.length,
+                levels.length,
+                use_col,
+                (use_col ? col_data.offset : 0),
+                (use_col ? col_data.length : 0),
+                chunkCacheSize,
+                blockSize,
+                directChunkRead,
+                stats.offset,
+                nthreads
+            ));
+        }
+
+        levels.forEach((x, i) => {
+            output.add(x, gc.call(module => raw.get(i), ScranMatrix));
+        });
+
+        if (statistics !== null) {
+            let sarr = stats.array();
+            statistics.bytesRead = sarr[0];
+            statistics.readCalls = sarr[1];
+        }
+
+    } catch (e) {
+        utils.free(output);
+        throw e;
+
+    } finally {
+        if (raw) {
+            raw.delete();
+        }
+        utils.free(mod_data);
+        utils.free(col_data);
+        utils.free(image);
+        utils.free(stats);
+    }
+
+    return output;
 }
 
 /**
@@ -232,21 +651,39 @@ export function initializeSparseMatrixFromHDF5(file, name) {
  * @param {number} numberOfColumns - Number of columns.
  * @param {(WasmArray|TypedArray|Array)} values - Array of length equal to the product of `numberOfRows` and `numberOfColumns`,
  * containing the values to store in the array.
+ * Integer and single-precision inputs are stored in their original type, which saves memory compared to conversion to double-precision.
+ * @param {object} [options] - Optional parameters.
+ * @param {boolean} [options.borrow=false] - Whether the returned matrix should refer directly to `values` instead of making a copy.
+ * This is only supported if `values` is a Float64WasmArray on the **scran.js** Wasm heap.
+ * If `true`, `values` must not be freed before the returned matrix (and any of its clones) are freed.
+ * @param {boolean} [options.float32=false] - Whether to store double-precision `values` in single precision.
+ * This halves the memory usage at the cost of some precision.
+ * Downstream functions still compute in double precision, converting one row or column at a time.
+ * Ignored if `borrow = true`.
  *
  * @return {ScranMatrix} A dense matrix, filled by column with the contents of `values`.
  */
-export function initializeDenseMatrixFromDenseArray(numberOfRows, numberOfColumns, values) {
+export function initializeDenseMatrixFromDenseArray(numberOfRows, numberOfColumns, values, { borrow = false, float32 = false } = {}) {
     var tmp;
     var output;
 
     try {
+        if (borrow && !(values instanceof wa.Float64WasmArray && values.space === wasm.wasmArraySpace())) {
+            throw new Error("'values' should be a Float64WasmArray on the scran.js Wasm heap when 'borrow = true'");
+        }
+        if (values.length !== numberOfRows * numberOfColumns) {
+            throw new Error("length of 'values' is not consistent with supplied dimensions");
+        }
+
         tmp = utils.wasmifyArray(values, null);
         output = gc.call(
             module => module.initialize_dense_matrix(
                 numberOfRows, 
                 numberOfColumns, 
                 tmp.offset, 
-                tmp.constructor.className.replace("Wasm", "")
+                tmp.constructor.className.replace("Wasm", ""),
+                borrow,
+                float32
             ),
             ScranMatrix
         );
@@ -0,0 +1,25 @@
+import * as gc from "./../gc.js";
+import * as utils from "./../utils.js";
+
+export function loadFromPathOrBuffer(x, fromBuffer, fromFile, cls) {
+    var buf_data;
+    var output;
+
+    try {
+        if (typeof x !== "string") {
+            buf_data = utils.wasmifyArray(x, "Uint8WasmArray");
+            output = gc.call(module => fromBuffer(module, buf_data.offset, buf_data.length), cls);
+        } else {
+            output = gc.call(module => fromFile(module, x), cls);
+        }
+
+    } catch(e) {
+        utils.free(output);
+        throw e;
+
+    } finally {
+        utils.free(buf_data);
+    }
+
+    return output;
+}
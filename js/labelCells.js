@@ -241,10 +241,11 @@ function label_cells(x, expectedNumberOfFeatures, buffer, numberOfFeatures, numb
             }
 
             // This will either create a cheap view, or it'll clone
-            // 'x' into the appropriate memory space.
+            // 'x' into the appropriate memory space. We can borrow as
+            // 'tempmat' is freed before 'matbuf'.
             matbuf = utils.wasmifyArray(x, null);
             tempmat = gc.call(
-                module => module.initialize_dense_matrix(numberOfFeatures, numberOfCells, matbuf.offset, "Float64Array"),
+                module => module.initialize_dense_matrix(numberOfFeatures, numberOfCells, matbuf.offset, "Float64Array", true, false),
                 ScranMatrix
             );
             target = tempmat.matrix;
@@ -271,8 +272,8 @@ function label_cells(x, expectedNumberOfFeatures, buffer, numberOfFeatures, numb
         }
 
     } finally {
-        utils.free(matbuf);
         utils.free(tempmat);
+        utils.free(matbuf);
         utils.free(tempbuf);
     }
 
@@ -290,15 +291,18 @@ function label_cells(x, expectedNumberOfFeatures, buffer, numberOfFeatures, numb
  * @param {number} [options.numberOfFeatures=null] - Number of features, used when `x` is a Float64WasmArray.
  * @param {number} [options.numberOfCells=null] - Number of cells, used when `x` is a Float64WasmArray.
  * @param {number} [options.quantile=0.8] - Quantile on the correlations to use to compute the score for each label.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {Int32Array} Array containing the labels for each cell in `x`.
  *
  * If `buffer` was supplied, the returned array is a view into it.
  * Note that this may be invalidated on the next allocation on the Wasm heap.
  */
-export function labelCells(x, reference, { buffer = null, numberOfFeatures = null, numberOfCells = null, quantile = 0.8 } = {}) {
+export function labelCells(x, reference, { buffer = null, numberOfFeatures = null, numberOfCells = null, quantile = 0.8, numberOfThreads = null } = {}) {
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
     let FUN = (target, ptr) => {
-        wasm.call(module => module.run_singlepp(target, reference.reference, quantile, ptr));
+        wasm.call(module => module.run_singlepp(target, reference.reference, quantile, ptr, nthreads));
     };
 
     let output = label_cells(x, reference.expectedNumberOfFeatures, buffer, numberOfFeatures, numberOfCells, FUN, "reference");
@@ -461,14 +465,17 @@ export function integrateLabelledReferences(features, loaded, referenceFeatures,
  * @param {number} [options.numberOfFeatures=null] - Number of features, used when `x` is a Float64WasmArray.
  * @param {number} [options.numberOfCells=null] - Number of cells, used when `x` is a Float64WasmArray.
  * @param {number} [options.quantile=0.8] - Quantile on the correlations to use to compute the score for each label.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {Int32Array} Array containing the best reference for each cell in `x`.
  *
  * If `buffer` was supplied, the returned array is a view into it.
  * Note that this may be invalidated on the next allocation on the Wasm heap.
  */
-export function integrateCellLabels(x, assigned, integrated, { buffer = null, numberOfFeatures = null, numberOfCells = null, quantile = 0.8 } = {}) { 
+export function integrateCellLabels(x, assigned, integrated, { buffer = null, numberOfFeatures = null, numberOfCells = null, quantile = 0.8, numberOfThreads = null } = {}) { 
     let nrefs = integrated.numberOfReferences();
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
     if (assigned.length != nrefs) {
         throw new Error("length of 'assigned' should be equal to the number of references in 'integrated'");
     }
@@ -500,7 +507,7 @@ export function integrateCellLabels(x, assigned, integrated, { buffer = null, nu
         }
     
         let FUN = (target, ptr) => {
-            wasm.call(module => module.integrate_singlepp(target, aptrs_arr.offset, integrated.integrated, quantile, ptr));
+            wasm.call(module => module.integrate_singlepp(target, aptrs_arr.offset, integrated.integrated, quantile, ptr, nthreads));
         };
         output = label_cells(x, integrated.expectedNumberOfFeatures, buffer, numberOfFeatures, numberOfCells, FUN, "integrated");
 
@@ -16,13 +16,16 @@ import * as utils from "./utils.js";
  * @param {boolean} [options.allowZeros=false] - Whether size factors of zero should be allowed.
  * If `true`, no scaling normalization is performed for the corresponding cells, under the assumption they are all-zero libraries.
  * If `false`, an error is raised instead.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {ScranMatrix} A matrix of the same type as `x` containing log-transformed normalized expression values.
  */
-export function logNormCounts(x, { sizeFactors = null, block = null, allowZeros = false } = {}) {
+export function logNormCounts(x, { sizeFactors = null, block = null, allowZeros = false, numberOfThreads = null } = {}) {
     var sf_data;
     var block_data;
     var output;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
 
     try {
         var sfptr = 0;
@@ -50,7 +53,7 @@ export function logNormCounts(x, { sizeFactors = null, block = null, allowZeros
         }
 
         output = gc.call(
-            module => module.log_norm_counts(x.matrix, use_sf, sfptr, use_blocks, bptr, allowZeros),
+            module => module.log_norm_counts(x.matrix, use_sf, sfptr, use_blocks, bptr, allowZeros, nthreads),
             x.constructor
         );
 
@@ -21,23 +21,26 @@ import * as utils from "./utils.js";
  * @param {?Float64WasmArray} [options.buffer=null] - Buffer in which to store the output size factors.
  * Length should be equal to the number of columns in `x`.
  * If `null`, an array is allocated by the function.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  * 
  * @return {Float64WasmArray} Per-cell size factors for each column of `x`.
  *
  * If `buffer` is supplied, it is directly used as the return value.
  */
-export function quickAdtSizeFactors(x, { numberOfClusters = 20, numberOfPCs = 25, totals = null, block = null, buffer = null } = {}) {
+export function quickAdtSizeFactors(x, { numberOfClusters = 20, numberOfPCs = 25, totals = null, block = null, buffer = null, numberOfThreads = null } = {}) {
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
     let norm, pcs;
     try {
-        norm = lognorm.logNormCounts(x, { sizeFactors: totals, block: block });
-        pcs = pca.runPCA(norm, { numberOfPCs: Math.min(norm.numberOfRows() - 1, numberOfPCs) });
+        norm = lognorm.logNormCounts(x, { sizeFactors: totals, block: block, numberOfThreads: nthreads });
+        pcs = pca.runPCA(norm, { numberOfPCs: Math.min(norm.numberOfRows() - 1, numberOfPCs), numberOfThreads: nthreads });
     } finally {
         utils.free(norm);
     }
 
     let clust;
     try {
-        clust = cluster.clusterKmeans(pcs, numberOfClusters);
+        clust = cluster.clusterKmeans(pcs, numberOfClusters, { numberOfThreads: nthreads });
     } finally {
         utils.free(pcs);
     }
@@ -50,7 +53,7 @@ export function quickAdtSizeFactors(x, { numberOfClusters = 20, numberOfPCs = 25
         } else if (buffer.length !== x.numberOfColumns()) {
             throw new Error("length of 'buffer' should be equal to the number of columns in 'x'");
         }
-        grouped.groupedSizeFactors(x, clust.clusters({ copy: "view" }), { buffer: buffer });
+        grouped.groupedSizeFactors(x, clust.clusters({ copy: "view" }), { buffer: buffer, numberOfThreads: nthreads });
 
     } catch (e) {
         utils.free(local_buffer);
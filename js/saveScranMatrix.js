@@ -0,0 +1,45 @@
+import * as wasm from "./wasm.js";
+import * as utils from "./utils.js"; 
+import { ScranMatrix } from "./ScranMatrix.js";
+import { loadFromPathOrBuffer } from "./internal/loadFromPathOrBuffer.js";
+
+/**
+ * Save a count matrix to a native binary snapshot.
+ * This contains the components of the layered sparse representation along with the row identities,
+ * allowing the same matrix to be quickly restored with {@linkcode loadScranMatrix} without re-parsing or re-converting the original file.
+ *
+ * @param {ScranMatrix} x - A matrix of non-negative integers, typically created by one of the `initializeSparseMatrix*` functions.
+ * @param {string} path - Path to the output file.
+ * On browsers, this should be a path in the virtual filesystem, which can be retrieved with {@linkcode readFile}.
+ * @param {object} [options] - Optional parameters.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return The snapshot is written to `path`.
+ * If `x` is not already a layered sparse matrix, its rows are reorganized into the layered representation,
+ * so the row identities of the loaded matrix may differ from those of `x`.
+ */
+export function saveScranMatrix(x, path, { numberOfThreads = null } = {}) {
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+    wasm.call(module => module.save_numeric_matrix(x.matrix, path, nthreads));
+    return;
+}
+
+/**
+ * Load a matrix from a snapshot created by {@linkcode saveScranMatrix}.
+ * This only involves reading the stored arrays, so the time taken is proportional to the size of the file.
+ *
+ * @param {Uint8WasmArray|Array|TypedArray|string} x - Byte array containing the contents of the snapshot.
+ * Alternatively, a string containing a file path to the snapshot, which avoids holding a copy of the file in memory.
+ * On browsers, this should be a path in the virtual filesystem, typically created with {@linkcode writeFile}.
+ *
+ * @return {ScranMatrix} A layered sparse matrix with the same values and row identities as the saved matrix.
+ */
+export function loadScranMatrix(x) {
+    return loadFromPathOrBuffer(
+        x,
+        (module, offset, length) => module.load_numeric_matrix_from_buffer(offset, length),
+        (module, path) => module.load_numeric_matrix_from_file(path),
+        ScranMatrix
+    );
+}
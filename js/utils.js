@@ -1,4 +1,4 @@
-import { buffer, wasmArraySpace } from "./wasm.js";
+import { buffer, wasmArraySpace, maximumThreads } from "./wasm.js";
 import * as wa from "wasmarrays.js";
 
 /**
@@ -149,3 +149,13 @@ export function matchOptions(name, value, choices) {
         throw new Error("'" + name + "=' should be one of '" + choices.join("', '") + "'");
     }
 }
+
+export function chooseNumberOfThreads(numberOfThreads) {
+    if (numberOfThreads === null) {
+        return maximumThreads();
+    }
+    if (!Number.isInteger(numberOfThreads) || numberOfThreads < 1) {
+        throw new Error("'numberOfThreads=' should be a positive integer");
+    }
+    return numberOfThreads;
+}
@@ -30,6 +30,8 @@ export async function initialize({ numberOfThreads = 4, localFile = false } = {}
 
     cache.module = await loadScran(options);
     cache.space = register(cache.module);
+    cache.threads = numberOfThreads;
+    cache.wasm64 = (cache.module.pointer_size() == 8);
 
     return true;
 }
@@ -43,8 +45,9 @@ export function call(func) {
     try {
         output = func(cache.module);    
     } catch (e) {
-        if (typeof e == "number") {
-            throw new Error(cache.module.get_error_message(e));
+        // Exception pointers may be BigInts in wasm64 builds.
+        if (typeof e == "number" || typeof e == "bigint") {
+            throw new Error(cache.module.get_error_message(Number(e)));
         } else {
             throw e;
         }
@@ -56,9 +59,27 @@ export function buffer() {
     if (! ("module" in cache)) {
         throw new Error("Wasm module needs to be initialized via 'initialize()'");
     }
+    // Offsets into this buffer may exceed 2^32 in wasm64 builds, which is
+    // fine as TypedArray offsets and lengths are represented as Numbers.
     return cache.module.wasmMemory.buffer;
 }
 
+/**
+ * @return {boolean} Whether the Wasm binary was compiled with 64-bit memory.
+ * If `true`, the Wasm heap can grow beyond 4 GB, e.g., to handle very large datasets.
+ */
+export function isWasm64() {
+    return cache.wasm64;
+}
+
+/**
+ * @return {number} Maximum number of threads available for computation.
+ * This is the `numberOfThreads` specified in {@linkcode initialize}.
+ */
+export function maximumThreads() {
+    return cache.threads;
+}
+
 /**
  * @return {number} Integer containing the **wasmarrays.js** identifier for **scran.js**'s memory space.
  * This can be used with `createWasmArray()` and related functions from **wasmarrays.js**.
@@ -79,7 +100,8 @@ export function terminate() {
 }
 
 /**
- * @return {number} The current size of the Wasm heap, typically used for diagnostic reporting.
+ * @return {number} The current size of the Wasm heap in bytes, typically used for diagnostic reporting.
+ * This may be greater than 4 GB if {@linkcode isWasm64} is `true`.
  */
 export function heapSize() {
     return buffer().byteLength;
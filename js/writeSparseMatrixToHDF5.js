@@ -0,0 +1,29 @@
+import * as wasm from "./wasm.js";
+import * as utils from "./utils.js"; 
+
+/**
+ * Write a matrix to a HDF5 file in a compressed sparse column format.
+ * Any delayed operations on `x` (e.g., subsetting, log-normalization) are evaluated as the columns are written,
+ * so there is no need to realize the entire matrix in memory.
+ *
+ * @param {ScranMatrix} x - A matrix where the rows are features and the columns are cells.
+ * @param {string} path - Path to an existing HDF5 file, e.g., created by {@linkcode createNewHDF5File}.
+ * On browsers, this should be a path in the virtual filesystem, which can be retrieved with {@linkcode readFile}.
+ * @param {string} name - Name of the group to create in the file.
+ * @param {object} [options] - Optional parameters.
+ * @param {string} [options.format="10x"] - Format of the group, either `"10x"` (dimensions in a `shape` dataset) or `"h5ad"` (dimensions, encoding type and encoding version in attributes).
+ * @param {number} [options.deflateLevel=6] - DEFLATE compression level for the `data` and `indices` datasets, from 0 to 9.
+ * @param {number} [options.chunkSize=100000] - Number of elements in each chunk of the `data` and `indices` datasets.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return A group is created at `name` in `path`, containing the `data`, `indices` and `indptr` datasets.
+ * Values are stored as 32-bit integers if they are all integral, otherwise they are stored as doubles.
+ * If the rows of `x` were reorganized, they are written in the order of their identities, i.e., the original order of the rows in the source file.
+ * The group can be loaded back with {@linkcode initializeSparseMatrixFromHDF5}.
+ */
+export function writeSparseMatrixToHDF5(x, path, name, { format = "10x", deflateLevel = 6, chunkSize = 100000, numberOfThreads = null } = {}) {
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+    wasm.call(module => module.write_sparse_matrix_to_hdf5(x.matrix, path, name, format, deflateLevel, chunkSize, nthreads));
+    return;
+}
@@ -3,6 +3,7 @@
 #include "knncolle/knncolle.hpp"
 #include "NeighborIndex.h"
 #include "parallel.h"
+#include "utils.h"
 
 /**
  * @param[in] mat An offset to a 2D array with dimensions (e.g., principal components) in rows and cells in columns.
@@ -26,26 +27,53 @@ NeighborIndex build_neighbor_index(uintptr_t mat, int nr, int nc, bool approxima
 /**
  * @param index Prebuilt nearest neighbor search index.
  * @param k Number of nearest neighbors to identify.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
  *
  * @return A `NeighborResults` containing the search results for each cell.
  */
-NeighborResults find_nearest_neighbors(const NeighborIndex& index, int k) {
+NeighborResults find_nearest_neighbors(const NeighborIndex& index, int k, int nthreads) {
+    ScopedExecutionContext scope{ ExecutionContext(nthreads) };
+
     size_t nc = index.search->nobs();
     NeighborResults output(nc);
     const auto& search = index.search;
-    auto& x = output.neighbors;
 
-#ifdef __EMSCRIPTEN_PTHREADS__
+    // Each cell gets a slot of length 'k' in the flat arrays. Query costs vary
+    // a lot between cells, so we use small chunks that can be stolen by idle
+    // threads rather than a single range per thread.
+    size_t kk = k;
+    auto& indices = output.indices;
+    auto& distances = output.distances;
+    indices.resize(nc * kk);
+    distances.resize(nc * kk);
+    std::vector<int> counts(nc);
+
     run_parallel(nc, [&](int left, int right) -> void {
         for (int i = left; i < right; ++i) {
-            x[i] = search->find_nearest_neighbors(i, k);
+            auto current = search->find_nearest_neighbors(i, k);
+            counts[i] = current.size();
+            size_t j = i * kk;
+            for (const auto& y : current) {
+                indices[j] = y.first;
+                distances[j] = y.second;
+                ++j;
+            }
         }
-    });
-#else
+    }, 64);
+
+    // Closing the gaps if any cell has fewer than 'k' neighbors, e.g., if 'k' is greater than the number of other cells.
+    auto& offsets = output.offsets;
     for (size_t i = 0; i < nc; ++i) {
-        x[i] = search->find_nearest_neighbors(i, k);
+        offsets[i + 1] = offsets[i] + counts[i];
+        if (offsets[i] != i * kk) {
+            std::copy_n(indices.begin() + i * kk, counts[i], indices.begin() + offsets[i]);
+            std::copy_n(distances.begin() + i * kk, counts[i], distances.begin() + offsets[i]);
+        }
     }
-#endif
+    indices.resize(offsets.back());
+    distances.resize(offsets.back());
+
     return output;
 }
 
@@ -53,19 +81,22 @@ NeighborResults find_nearest_neighbors(const NeighborIndex& index, int k) {
  * @cond
  */
 EMSCRIPTEN_BINDINGS(build_neighbor_index) {
-    emscripten::function("find_nearest_neighbors", &find_nearest_neighbors);
+    emscripten::function("find_nearest_neighbors", &js_bind<&find_nearest_neighbors>::fun);
 
-    emscripten::function("build_neighbor_index", &build_neighbor_index);
+    emscripten::function("build_neighbor_index", &js_bind<&build_neighbor_index>::fun);
 
     emscripten::class_<NeighborIndex>("NeighborIndex")
-        .function("num_obs", &NeighborIndex::num_obs)
-        .function("num_dim", &NeighborIndex::num_dim);
+        .function("num_obs", &js_bind<&NeighborIndex::num_obs>::fun)
+        .function("num_dim", &js_bind<&NeighborIndex::num_dim>::fun);
     
     emscripten::class_<NeighborResults>("NeighborResults")
-        .constructor<size_t, uintptr_t, uintptr_t, uintptr_t>()
-        .function("num_obs", &NeighborResults::num_obs)
-        .function("size", &NeighborResults::size)
-        .function("serialize", &NeighborResults::serialize);
+        .constructor(&js_construct<NeighborResults, size_t, uintptr_t, uintptr_t, uintptr_t>, emscripten::allow_raw_pointers())
+        .function("num_obs", &js_bind<&NeighborResults::num_obs>::fun)
+        .function("size", &js_bind<&NeighborResults::size>::fun)
+        .function("serialize", &js_bind<&NeighborResults::serialize>::fun)
+        .function("offsets", &js_bind<&NeighborResults::offsets_view>::fun)
+        .function("indices", &js_bind<&NeighborResults::indices_view>::fun)
+        .function("distances", &js_bind<&NeighborResults::distances_view>::fun);
 }
 /**
  * @endcond
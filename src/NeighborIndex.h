@@ -1,9 +1,12 @@
 #ifndef NEIGHBOR_INDEX_H
 #define NEIGHBOR_INDEX_H
 
+#include <emscripten/bind.h>
 #include "knncolle/knncolle.hpp"
 #include <memory>
 #include <vector>
+#include <algorithm>
+#include <cstdint>
 
 /**
  * @brief Prebuilt nearest neighbor index.
@@ -37,6 +40,8 @@ NeighborIndex build_neighbor_index(uintptr_t, int, int, bool);
 /**
  * @brief Nearest neighbor search results.
  *
+ * Results for all observations are stored contiguously, 
+ * where the neighbors of observation `i` are stored in `indices` and `distances` from `offsets[i]` to `offsets[i + 1]`.
  */
 struct NeighborResults { 
     /**
@@ -44,9 +49,28 @@ struct NeighborResults {
      */
     typedef std::vector<std::vector<std::pair<int, double> > > Neighbors;
 
-    NeighborResults(size_t n) : neighbors(n) {}
+    NeighborResults(size_t n) : offsets(n + 1) {}
 
-    Neighbors neighbors;
+    // 32-bit like the edge offsets of the SNN graph, so that offsets_view() is a Uint32Array in both wasm32 and wasm64 builds.
+    std::vector<uint32_t> offsets;
+
+    std::vector<int32_t> indices;
+
+    std::vector<double> distances;
+
+    // For libraries that need a per-observation list of neighbors.
+    Neighbors to_list() const {
+        size_t n = num_obs();
+        Neighbors output(n);
+        for (size_t i = 0; i < n; ++i) {
+            auto& current = output[i];
+            current.reserve(offsets[i + 1] - offsets[i]);
+            for (size_t j = offsets[i]; j < offsets[i + 1]; ++j) {
+                current.emplace_back(indices[j], distances[j]);
+            }
+        }
+        return output;
+    }
     /**
      * @endcond
      */
@@ -55,18 +79,14 @@ struct NeighborResults {
      * @return The size of the neighbor search results, i.e., the total number of neighbors across all observations.
      */
     size_t size() const {
-        size_t out = 0;
-        for (const auto& current : neighbors) {
-            out += current.size();
-        }
-        return out;
+        return indices.size();
     }
 
     /**
      * @return The number of observations.
      */
     size_t num_obs() const {
-        return neighbors.size();
+        return offsets.size() - 1;
     }
 
     /**
@@ -82,24 +102,37 @@ struct NeighborResults {
      */
     void serialize(uintptr_t runs, uintptr_t indices, uintptr_t distances) const {
         auto rptr = reinterpret_cast<int*>(runs);
-        auto iptr = reinterpret_cast<int*>(indices);
-        auto dptr = reinterpret_cast<double*>(distances);
-
-        for (const auto& current : neighbors) {
-            *rptr = current.size();
-            ++rptr;
-
-            for (const auto& x : current) {
-                *iptr = x.first;
-                *dptr = x.second;
-                ++iptr;
-                ++dptr;
-            }
+        size_t n = num_obs();
+        for (size_t i = 0; i < n; ++i) {
+            rptr[i] = offsets[i + 1] - offsets[i];
         }
 
+        std::copy(this->indices.begin(), this->indices.end(), reinterpret_cast<int*>(indices));
+        std::copy(this->distances.begin(), this->distances.end(), reinterpret_cast<double*>(distances));
         return;
     }
 
+    /**
+     * @return `Uint32Array` view of length equal to `num_obs() + 1`, containing the offsets of each observation's neighbors in `indices_view()` and `distances_view()`.
+     */
+    emscripten::val offsets_view() const {
+        return emscripten::val(emscripten::typed_memory_view(offsets.size(), offsets.data()));
+    }
+
+    /**
+     * @return `Int32Array` view of length equal to `size()`, containing the indices of the neighbors for each observation.
+     */
+    emscripten::val indices_view() const {
+        return emscripten::val(emscripten::typed_memory_view(indices.size(), indices.data()));
+    }
+
+    /**
+     * @return `Float64Array` view of length equal to `size()`, containing the distances to the neighbors for each observation.
+     */
+    emscripten::val distances_view() const {
+        return emscripten::val(emscripten::typed_memory_view(distances.size(), distances.data()));
+    }
+
     /**
      * Manually reconstruct the nearest neighbor search results, usually from a separate memory space.
      * 
@@ -111,20 +144,19 @@ struct NeighborResults {
      * @param[in] distances Offset to a double-precision array of length equal to the number of neighbors across all observations.
      * This contains the distances to the neighbors for each observation.
      */
-    NeighborResults(size_t n, uintptr_t runs, uintptr_t indices, uintptr_t distances) : neighbors(n) {
+    NeighborResults(size_t n, uintptr_t runs, uintptr_t indices, uintptr_t distances) : offsets(n + 1) {
         auto rptr = reinterpret_cast<const int*>(runs);
-        auto iptr = reinterpret_cast<const int*>(indices);
-        auto dptr = reinterpret_cast<const double*>(distances);
-
         for (size_t i = 0; i < n; ++i) {
-            neighbors[i].reserve(rptr[i]);
-            for (int j = 0; j < rptr[i]; ++j, ++iptr, ++dptr) {
-                neighbors[i].emplace_back(*iptr, *dptr);
-            }
+            offsets[i + 1] = offsets[i] + rptr[i];
         }
+
+        auto iptr = reinterpret_cast<const int*>(indices);
+        this->indices.insert(this->indices.end(), iptr, iptr + offsets.back());
+        auto dptr = reinterpret_cast<const double*>(distances);
+        this->distances.insert(this->distances.end(), dptr, dptr + offsets.back());
     }
 };
 
-NeighborResults find_nearest_neighbors(const NeighborIndex&, int);
+NeighborResults find_nearest_neighbors(const NeighborIndex&, int, int);
 
 #endif
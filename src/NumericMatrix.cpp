@@ -1,6 +1,7 @@
 #include <emscripten/bind.h>
 #include "NumericMatrix.h"
 #include "JSVector.h"
+#include "utils.h"
 
 NumericMatrix::NumericMatrix(const tatami::NumericMatrix* p) : ptr(std::shared_ptr<const tatami::NumericMatrix>(p)), is_reorganized(false) {}
 
@@ -58,12 +59,18 @@ bool NumericMatrix::sparse() const {
     return ptr->sparse(); 
 }
 
+bool NumericMatrix::file_backed() const {
+    return is_file_backed;
+}
+
 NumericMatrix NumericMatrix::clone() const {
-    if (is_reorganized) {
-        return NumericMatrix(ptr, row_ids);
-    } else {
-        return NumericMatrix(ptr);
-    }
+    return derive(ptr);
+}
+
+NumericMatrix NumericMatrix::derive(std::shared_ptr<const tatami::NumericMatrix> p) const {
+    auto output = (is_reorganized ? NumericMatrix(std::move(p), row_ids) : NumericMatrix(std::move(p)));
+    output.is_file_backed = is_file_backed;
+    return output;
 }
 
 /**
@@ -71,15 +78,16 @@ NumericMatrix NumericMatrix::clone() const {
  */
 EMSCRIPTEN_BINDINGS(NumericMatrix) {
     emscripten::class_<NumericMatrix>("NumericMatrix")
-        .constructor<int, int, uintptr_t>()
-        .function("nrow", &NumericMatrix::nrow)
-        .function("ncol", &NumericMatrix::ncol)
-        .function("row", &NumericMatrix::row)
-        .function("column", &NumericMatrix::column)
-        .function("identities", &NumericMatrix::identities)
-        .function("reorganized", &NumericMatrix::reorganized)
-        .function("sparse", &NumericMatrix::sparse)
-        .function("clone", &NumericMatrix::clone)
+        .constructor(&js_construct<NumericMatrix, int, int, uintptr_t>, emscripten::allow_raw_pointers())
+        .function("nrow", &js_bind<&NumericMatrix::nrow>::fun)
+        .function("ncol", &js_bind<&NumericMatrix::ncol>::fun)
+        .function("row", &js_bind<&NumericMatrix::row>::fun)
+        .function("column", &js_bind<&NumericMatrix::column>::fun)
+        .function("identities", &js_bind<&NumericMatrix::identities>::fun)
+        .function("reorganized", &js_bind<&NumericMatrix::reorganized>::fun)
+        .function("sparse", &js_bind<&NumericMatrix::sparse>::fun)
+        .function("file_backed", &js_bind<&NumericMatrix::file_backed>::fun)
+        .function("clone", &js_bind<&NumericMatrix::clone>::fun)
         ;
 }
 /**
@@ -98,8 +98,36 @@ struct NumericMatrix {
      */
     bool sparse() const;
 
+    /**
+     * @return Whether the underlying matrix (or any matrix that it was derived from) reads its values from a file.
+     */
+    bool file_backed() const;
+
+    /**
+     * @param nthreads Number of threads to use.
+     * If zero, all threads in the pool are used.
+     *
+     * @return Execution context for computations on this matrix.
+     * This is serialized if the matrix is file-backed, as the HDF5 library is not thread-safe.
+     */
+    ExecutionContext execution_context(int nthreads) const {
+        if (is_file_backed) {
+            return ExecutionContext(1, 0, true);
+        } else {
+            return ExecutionContext(nthreads);
+        }
+    }
+
     NumericMatrix clone() const;
 
+    /**
+     * @param p Pointer to a `tatami::NumericMatrix` that was derived from `ptr` without changing the rows,
+     * e.g., by transforming the values or subsetting the columns.
+     *
+     * @return A `NumericMatrix` containing `p`, with the same row identities and file-backed status as this object.
+     */
+    NumericMatrix derive(std::shared_ptr<const tatami::NumericMatrix> p) const;
+
     /** 
      * @cond
      */
@@ -108,6 +136,8 @@ struct NumericMatrix {
     std::vector<size_t> row_ids;
 
     bool is_reorganized;
+
+    bool is_file_backed = false;
     /**
      * @endcond
      */
@@ -8,6 +8,21 @@
 #include "utils.h"
 #include "tatami/tatami.hpp"
 
+/**
+ * @cond
+ */
+static bool any_file_backed(const std::vector<const NumericMatrix*>& mats) {
+    for (auto m : mats) {
+        if (m->is_file_backed) {
+            return true;
+        }
+    }
+    return false;
+}
+/**
+ * @endcond
+ */
+
 NumericMatrix cbind(int n, uintptr_t mats, bool same_perm) {
     if (n == 0) {
         throw std::runtime_error("need at least one matrix to cbind");
@@ -84,12 +99,9 @@ NumericMatrix cbind(int n, uintptr_t mats, bool same_perm) {
         }
     }
 
-    auto bound = tatami::make_DelayedBind<1>(std::move(collected));
-    if (first.is_reorganized) {
-        return NumericMatrix(std::move(bound), first.row_ids);
-    } else {
-        return NumericMatrix(std::move(bound));
-    }
+    auto output = first.derive(tatami::make_DelayedBind<1>(std::move(collected)));
+    output.is_file_backed = any_file_backed(mat_ptrs);
+    return output;
 }
 
 NumericMatrix cbind_with_rownames(int n, uintptr_t mats, uintptr_t names, uintptr_t indices) {
@@ -123,16 +135,18 @@ NumericMatrix cbind_with_rownames(int n, uintptr_t mats, uintptr_t names, uintpt
         }
     }
 
-    return NumericMatrix(std::move(out.first), std::move(idx));
+    NumericMatrix output(std::move(out.first), std::move(idx));
+    output.is_file_backed = any_file_backed(mat_ptrs);
+    return output;
 }
 
 /**
  * @cond
  */
 EMSCRIPTEN_BINDINGS(cbind) {
-    emscripten::function("cbind", &cbind);
+    emscripten::function("cbind", &js_bind<&cbind>::fun);
 
-    emscripten::function("cbind_with_rownames", &cbind_with_rownames);
+    emscripten::function("cbind_with_rownames", &js_bind<&cbind_with_rownames>::fun);
 }
 /**
  * @endcond
@@ -7,6 +7,7 @@
 #include "kmeans/InitializeRandom.hpp"
 #include "kmeans/InitializeKmeansPP.hpp"
 #include "kmeans/InitializePCAPartition.hpp"
+#include "utils.h"
 #include <algorithm>
 #include <memory>
 
@@ -105,10 +106,14 @@ struct ClusterKmeans_Result {
  * @param init_seed Random seed to use for initialization.
  * @param init_pca_adjust Adjustment factor to apply to the cluster sizes prior to the WCSS calculations in PCA partitioning.
  * Values below 1 reduce the preference towards choosing larger clusters for further partitioning.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
  *
  * @return A `ClusterKmeans_Result` object containing the... k-means clustering results, obviously.
  */
-ClusterKmeans_Result cluster_kmeans(uintptr_t mat, int nr, int nc, int k, std::string init_method, int init_seed, double init_pca_adjust) {
+ClusterKmeans_Result cluster_kmeans(uintptr_t mat, int nr, int nc, int k, std::string init_method, int init_seed, double init_pca_adjust, int nthreads) {
+    ScopedExecutionContext scope{ ExecutionContext(nthreads) };
+
     const double* ptr = reinterpret_cast<const double*>(mat);
 
     std::shared_ptr<kmeans::Initialize<> > iptr;
@@ -142,17 +147,17 @@ ClusterKmeans_Result cluster_kmeans(uintptr_t mat, int nr, int nc, int k, std::s
  * @cond
  */
 EMSCRIPTEN_BINDINGS(cluster_kmeans) {
-    emscripten::function("cluster_kmeans", &cluster_kmeans);
+    emscripten::function("cluster_kmeans", &js_bind<&cluster_kmeans>::fun);
 
     emscripten::class_<ClusterKmeans_Result>("ClusterKmeans_Result")
-        .function("num_obs", &ClusterKmeans_Result::num_obs)
-        .function("num_clusters", &ClusterKmeans_Result::num_clusters)
-        .function("cluster_sizes", &ClusterKmeans_Result::cluster_sizes)
-        .function("wcss", &ClusterKmeans_Result::wcss)
-        .function("clusters", &ClusterKmeans_Result::clusters)
-        .function("centers", &ClusterKmeans_Result::centers)
-        .function("iterations", &ClusterKmeans_Result::iterations)
-        .function("status", &ClusterKmeans_Result::status);
+        .function("num_obs", &js_bind<&ClusterKmeans_Result::num_obs>::fun)
+        .function("num_clusters", &js_bind<&ClusterKmeans_Result::num_clusters>::fun)
+        .function("cluster_sizes", &js_bind<&ClusterKmeans_Result::cluster_sizes>::fun)
+        .function("wcss", &js_bind<&ClusterKmeans_Result::wcss>::fun)
+        .function("clusters", &js_bind<&ClusterKmeans_Result::clusters>::fun)
+        .function("centers", &js_bind<&ClusterKmeans_Result::centers>::fun)
+        .function("iterations", &js_bind<&ClusterKmeans_Result::iterations>::fun)
+        .function("status", &js_bind<&ClusterKmeans_Result::status>::fun);
 }
 /**
  * @endcond
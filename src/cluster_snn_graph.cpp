@@ -4,8 +4,15 @@
 #include "parallel.h"
 
 #include "scran/clustering/ClusterSNNGraph.hpp"
+#include "igraph.h"
+#include "utils.h"
+
 #include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <vector>
+#include <string>
+#include <stdexcept>
 
 /**
  * @file cluster_snn_graph.cpp
@@ -14,61 +21,312 @@
  */
 
 /**
- * @brief Javascript-visible wrapper around the result of `scran::BuildSNNGraph::run()`.
+ * @brief Shared nearest neighbor graph in compressed sparse row format.
+ *
+ * Each undirected edge is stored once, in the row of its larger endpoint.
+ * That is, the edges for cell `j` connect `j` to cells with smaller indices,
+ * and are stored in `targets` and `weights` between `offsets[j]` and `offsets[j + 1]`.
  */
 struct BuildSNNGraph_Result {
     /**
      * @cond
      **/
-    typedef std::deque<scran::BuildSNNGraph::WeightedEdge> Edges;
-
-    BuildSNNGraph_Result(size_t nc, Edges e) : ncells(nc), edges(std::move(e)) {}
+    BuildSNNGraph_Result(size_t nc, std::vector<uint32_t> o, std::vector<uint32_t> t, std::vector<float> w) : 
+        ncells(nc), offsets(std::move(o)), targets(std::move(t)), weights(std::move(w)) {}
 
     size_t ncells;
 
-    Edges edges;
+    std::vector<uint32_t> offsets;
+
+    std::vector<uint32_t> targets;
+
+    std::vector<float> weights;
     /**
      * @endcond
      */
+
+    /**
+     * @return Number of cells, i.e., vertices in the graph.
+     */
+    size_t num_cells() const {
+        return ncells;
+    }
+
+    /**
+     * @return Number of undirected edges in the graph.
+     */
+    size_t num_edges() const {
+        return targets.size();
+    }
+
+    /**
+     * @return `Uint32Array` view of length `num_cells() + 1`, containing the offsets of each cell's edges in `targets_view()` and `weights_view()`.
+     */
+    emscripten::val offsets_view() const {
+        return emscripten::val(emscripten::typed_memory_view(offsets.size(), offsets.data()));
+    }
+
+    /**
+     * @return `Uint32Array` view of length `num_edges()`, containing the other endpoint of each edge.
+     */
+    emscripten::val targets_view() const {
+        return emscripten::val(emscripten::typed_memory_view(targets.size(), targets.data()));
+    }
+
+    /**
+     * @return `Float32Array` view of length `num_edges()`, containing the weight of each edge.
+     */
+    emscripten::val weights_view() const {
+        return emscripten::val(emscripten::typed_memory_view(weights.size(), weights.data()));
+    }
 };
 
 /**
- * Build an shared nearest neighbor graph from existing neighbor search results.
- *
- * @param neighbors Pre-computed nearest neighbors for this dataset.
- * @param scheme Weighting scheme to use for the edges.
- * This can be done by highest shared `"rank"`, by `"number"` of shared neighbors, or by the `"jaccard"` index of nearest neighbor sets.
- *
- * @return A `BuildSNNGraph_Result` containing the graph information.
+ * @cond
  */
-BuildSNNGraph_Result build_snn_graph(const NeighborResults& neighbors, std::string scheme) {
-    size_t nc = neighbors.neighbors.size();
-    std::vector<std::vector<int > > indices(nc);
-    int k = 0;
+// Converting the CSR graph into igraph's inputs for the clusterers. This is
+// done on demand so that we don't hold two copies of the graph.
+struct IgraphInput {
+    IgraphInput(const BuildSNNGraph_Result& graph) {
+        size_t nedges = graph.num_edges();
+
+        igraph_vector_t edges;
+        igraph_vector_init(&edges, nedges * 2);
+        for (size_t j = 0; j < graph.ncells; ++j) {
+            for (auto e = graph.offsets[j]; e < graph.offsets[j + 1]; ++e) {
+                VECTOR(edges)[2 * e] = j;
+                VECTOR(edges)[2 * e + 1] = graph.targets[e];
+            }
+        }
+        igraph_create(&store, &edges, graph.ncells, IGRAPH_UNDIRECTED);
+        igraph_vector_destroy(&edges);
 
-    for (size_t i = 0; i < nc; ++i) {
-        auto current = neighbors.neighbors[i];
-        auto& output = indices[i];
-        k = current.size(); // just in case BuildSNNGraph needs the neighbors to be set.
-        for (const auto& y : current) {
-            output.push_back(y.first);
+        igraph_vector_init(&weights, nedges);
+        for (size_t e = 0; e < nedges; ++e) {
+            VECTOR(weights)[e] = graph.weights[e];
         }
     }
 
-    auto chosen = scran::BuildSNNGraph::RANKED;
+    ~IgraphInput() {
+        igraph_destroy(&store);
+        igraph_vector_destroy(&weights);
+    }
+
+    IgraphInput(const IgraphInput&) = delete;
+    IgraphInput& operator=(const IgraphInput&) = delete;
+
+    igraph_t store;
+    igraph_vector_t weights;
+};
+/**
+ * @endcond
+ */
+
+/**
+ * @cond
+ */
+enum class SNNScheme { RANKED, NUMBER, JACCARD };
+
+SNNScheme choose_snn_scheme(const std::string& scheme) {
     if (scheme == "rank") {
-        ;
+        return SNNScheme::RANKED;
     } else if (scheme == "number") {
-        chosen = scran::BuildSNNGraph::NUMBER;
+        return SNNScheme::NUMBER;
     } else if (scheme == "jaccard") {
-        chosen = scran::BuildSNNGraph::JACCARD;
-    } else {
-        throw std::runtime_error("no known weighting scheme '" + scheme + "'");
+        return SNNScheme::JACCARD;
+    }
+    throw std::runtime_error("no known weighting scheme '" + scheme + "'");
+}
+
+/*
+ * This is a parallelized version of scran::BuildSNNGraph::run(), which
+ * produces the same edges in the same order. We split the cells into blocks
+ * and build each block's edges in a separate buffer, which are concatenated
+ * into the CSR arrays at the end. Neighbors are accessed through `num_neighbors(i)` and
+ * `neighbor(i, r)` so that we don't have to copy them into a separate array.
+ */
+template<class NumNeighbors, class Neighbor>
+BuildSNNGraph_Result build_snn_graph_internal(size_t nc, NumNeighbors num_neighbors, Neighbor neighbor, SNNScheme scheme) {
+    // Building a host-based list of (cell, rank) pairs, where each cell is
+    // its own 0-th nearest neighbor. This is done serially in cell order so
+    // that each host list is sorted by cell index.
+    std::vector<size_t> host_offsets(nc + 1);
+    for (size_t i = 0; i < nc; ++i) {
+        ++host_offsets[i + 1];
+        int nn = num_neighbors(i);
+        for (int r = 0; r < nn; ++r) {
+            ++host_offsets[neighbor(i, r) + 1];
+        }
+    }
+    for (size_t i = 0; i < nc; ++i) {
+        host_offsets[i + 1] += host_offsets[i];
+    }
+
+    std::vector<std::pair<int, int> > hosts(host_offsets.back());
+    {
+        auto fill = host_offsets;
+        for (size_t i = 0; i < nc; ++i) {
+            hosts[fill[i]++] = std::make_pair(static_cast<int>(i), 0);
+            int nn = num_neighbors(i);
+            for (int r = 0; r < nn; ++r) {
+                hosts[fill[neighbor(i, r)]++] = std::make_pair(static_cast<int>(i), r + 1);
+            }
+        }
+    }
+
+    constexpr size_t block_size = 1024;
+    size_t nblocks = (nc + block_size - 1) / block_size;
+    std::vector<std::vector<std::pair<uint32_t, float> > > buffers(nblocks);
+    std::vector<uint32_t> offsets(nc + 1);
+
+    run_parallel(nblocks, [&](int first, int last) -> void {
+        std::vector<double> current_score(nc);
+        std::vector<int> current_added;
+
+        for (int b = first; b < last; ++b) {
+            auto& edges = buffers[b];
+            size_t jstart = b * block_size, jend = std::min(jstart + block_size, nc);
+
+            for (size_t j = jstart; j < jend; ++j) {
+                const int nneighbors = num_neighbors(j);
+
+                for (int i = 0; i <= nneighbors; ++i) {
+                    const int cur_neighbor = (i == 0 ? j : neighbor(j, i - 1));
+                    auto hIt = hosts.begin() + host_offsets[cur_neighbor], hEnd = hosts.begin() + host_offsets[cur_neighbor + 1];
+
+                    for (; hIt != hEnd; ++hIt) {
+                        const int othernode = hIt->first;
+                        if (othernode >= static_cast<int>(j)) { // avoid duplicates from symmetry; hosts are sorted so we can stop here.
+                            break;
+                        }
+
+                        auto& existing_other = current_score[othernode];
+                        if (scheme == SNNScheme::RANKED) {
+                            const double currank = hIt->second + i;
+                            if (existing_other == 0) {
+                                existing_other = currank;
+                                current_added.push_back(othernode);
+                            } else if (existing_other > currank) {
+                                existing_other = currank;
+                            }
+                        } else {
+                            if (existing_other == 0) {
+                                current_added.push_back(othernode);
+                            }
+                            ++existing_other;
+                        }
+                    }
+                }
+
+                for (auto othernode : current_added) {
+                    auto& otherscore = current_score[othernode];
+                    double finalscore;
+                    if (scheme == SNNScheme::RANKED) {
+                        finalscore = static_cast<double>(nneighbors) - 0.5 * otherscore;
+                    } else {
+                        finalscore = otherscore;
+                        if (scheme == SNNScheme::JACCARD) {
+                            finalscore = finalscore / (2 * (nneighbors + 1) - finalscore);
+                        }
+                    }
+
+                    edges.emplace_back(othernode, std::max(finalscore, 1e-6)); // Ensuring that an edge with a positive weight is always reported.
+                    otherscore = 0;
+                }
+                offsets[j + 1] = current_added.size();
+                current_added.clear();
+            }
+        }
+    });
+
+    for (size_t j = 0; j < nc; ++j) {
+        offsets[j + 1] += offsets[j];
     }
 
-    scran::BuildSNNGraph builder;
-    builder.set_neighbors(k).set_weighting_scheme(chosen);
-    return BuildSNNGraph_Result(nc, builder.run(indices));
+    std::vector<uint32_t> targets;
+    std::vector<float> weights;
+    targets.reserve(offsets.back());
+    weights.reserve(offsets.back());
+
+    for (auto& buffer : buffers) {
+        for (const auto& edge : buffer) {
+            targets.push_back(edge.first);
+            weights.push_back(edge.second);
+        }
+        buffer.clear();
+        buffer.shrink_to_fit();
+    }
+
+    return BuildSNNGraph_Result(nc, std::move(offsets), std::move(targets), std::move(weights));
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Build an shared nearest neighbor graph from existing neighbor search results.
+ *
+ * @param neighbors Pre-computed nearest neighbors for this dataset.
+ * @param scheme Weighting scheme to use for the edges.
+ * This can be done by highest shared `"rank"`, by `"number"` of shared neighbors, or by the `"jaccard"` index of nearest neighbor sets.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
+ *
+ * @return A `BuildSNNGraph_Result` containing the graph information.
+ */
+BuildSNNGraph_Result build_snn_graph(const NeighborResults& neighbors, std::string scheme, int nthreads) {
+    ScopedExecutionContext scope{ ExecutionContext(nthreads) };
+
+    const auto& offsets = neighbors.offsets;
+    const auto& indices = neighbors.indices;
+    return build_snn_graph_internal(
+        neighbors.num_obs(),
+        [&](size_t i) -> int { return offsets[i + 1] - offsets[i]; },
+        [&](size_t i, int r) -> int { return indices[offsets[i] + r]; },
+        choose_snn_scheme(scheme)
+    );
+}
+
+/**
+ * Build a shared nearest neighbor graph directly from a neighbor search index.
+ * This avoids materializing a `NeighborResults` object, as only the neighbor indices are needed to build the graph.
+ *
+ * @param index A pre-built neighbor search index for the dataset.
+ * @param k Number of neighbors to use to construct the graph.
+ * @param scheme Weighting scheme to use for the edges, see `build_snn_graph()`.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
+ *
+ * @return A `BuildSNNGraph_Result` containing the graph information.
+ */
+BuildSNNGraph_Result build_snn_graph_from_index(const NeighborIndex& index, int k, std::string scheme, int nthreads) {
+    ScopedExecutionContext scope{ ExecutionContext(nthreads) };
+    auto chosen = choose_snn_scheme(scheme);
+
+    size_t nc = index.num_obs();
+    std::vector<int> counts(nc);
+    std::vector<int> indices(nc * static_cast<size_t>(k));
+    const auto& search = index.search;
+
+    // Same chunking as find_nearest_neighbors(), as query costs vary between cells.
+    run_parallel(nc, [&](int left, int right) -> void {
+        for (int i = left; i < right; ++i) {
+            auto current = search->find_nearest_neighbors(i, k);
+            counts[i] = current.size();
+            auto out = indices.begin() + static_cast<size_t>(i) * k;
+            for (const auto& y : current) {
+                *out = y.first;
+                ++out;
+            }
+        }
+    }, 64);
+
+    return build_snn_graph_internal(
+        nc,
+        [&](size_t i) -> int { return counts[i]; },
+        [&](size_t i, int r) -> int { return indices[i * k + r]; },
+        chosen
+    );
 }
 
 /**
@@ -129,7 +387,8 @@ struct ClusterSNNGraphMultiLevel_Result {
 ClusterSNNGraphMultiLevel_Result cluster_snn_graph_multilevel(const BuildSNNGraph_Result& graph, double resolution) {
     scran::ClusterSNNGraphMultiLevel clust;
     clust.set_resolution(resolution);
-    auto output = clust.run(graph.ncells, graph.edges);
+    IgraphInput input(graph);
+    auto output = clust.run(&input.store, &input.weights);
     return ClusterSNNGraphMultiLevel_Result(std::move(output));
 }
 
@@ -157,7 +416,8 @@ struct ClusterSNNGraphWalktrap_Result {
 ClusterSNNGraphWalktrap_Result cluster_snn_graph_walktrap(const BuildSNNGraph_Result& graph, int steps) {
     scran::ClusterSNNGraphWalktrap clust;
     clust.set_steps(steps);
-    auto output = clust.run(graph.ncells, graph.edges);
+    IgraphInput input(graph);
+    auto output = clust.run(&input.store, &input.weights);
     return ClusterSNNGraphWalktrap_Result(std::move(output));
 }
 
@@ -181,7 +441,8 @@ struct ClusterSNNGraphLeiden_Result {
 ClusterSNNGraphLeiden_Result cluster_snn_graph_leiden(const BuildSNNGraph_Result& graph, double resolution) {
     scran::ClusterSNNGraphLeiden clust;
     clust.set_resolution(resolution);
-    auto output = clust.run(graph.ncells, graph.edges);
+    IgraphInput input(graph);
+    auto output = clust.run(&input.store, &input.weights);
     return ClusterSNNGraphLeiden_Result(std::move(output));
 }
 
@@ -189,29 +450,36 @@ ClusterSNNGraphLeiden_Result cluster_snn_graph_leiden(const BuildSNNGraph_Result
  * @cond
  */
 EMSCRIPTEN_BINDINGS(cluster_snn_graph) {
-    emscripten::function("build_snn_graph", &build_snn_graph);
+    emscripten::function("build_snn_graph", &js_bind<&build_snn_graph>::fun);
+
+    emscripten::function("build_snn_graph_from_index", &js_bind<&build_snn_graph_from_index>::fun);
 
-    emscripten::class_<BuildSNNGraph_Result>("BuildSNNGraph_Result");
+    emscripten::class_<BuildSNNGraph_Result>("BuildSNNGraph_Result")
+        .function("num_cells", &js_bind<&BuildSNNGraph_Result::num_cells>::fun)
+        .function("num_edges", &js_bind<&BuildSNNGraph_Result::num_edges>::fun)
+        .function("offsets", &js_bind<&BuildSNNGraph_Result::offsets_view>::fun)
+        .function("targets", &js_bind<&BuildSNNGraph_Result::targets_view>::fun)
+        .function("weights", &js_bind<&BuildSNNGraph_Result::weights_view>::fun);
 
-    emscripten::function("cluster_snn_graph_multilevel", &cluster_snn_graph_multilevel);
+    emscripten::function("cluster_snn_graph_multilevel", &js_bind<&cluster_snn_graph_multilevel>::fun);
 
     emscripten::class_<ClusterSNNGraphMultiLevel_Result>("ClusterSNNGraphMultiLevel_Result")
-        .function("number", &ClusterSNNGraphMultiLevel_Result::number)
-        .function("best", &ClusterSNNGraphMultiLevel_Result::best)
-        .function("modularity", &ClusterSNNGraphMultiLevel_Result::modularity)
-        .function("membership", &ClusterSNNGraphMultiLevel_Result::membership);
+        .function("number", &js_bind<&ClusterSNNGraphMultiLevel_Result::number>::fun)
+        .function("best", &js_bind<&ClusterSNNGraphMultiLevel_Result::best>::fun)
+        .function("modularity", &js_bind<&ClusterSNNGraphMultiLevel_Result::modularity>::fun)
+        .function("membership", &js_bind<&ClusterSNNGraphMultiLevel_Result::membership>::fun);
 
-    emscripten::function("cluster_snn_graph_walktrap", &cluster_snn_graph_walktrap);
+    emscripten::function("cluster_snn_graph_walktrap", &js_bind<&cluster_snn_graph_walktrap>::fun);
 
     emscripten::class_<ClusterSNNGraphWalktrap_Result>("ClusterSNNGraphWalktrap_Result")
-        .function("modularity", &ClusterSNNGraphWalktrap_Result::modularity)
-        .function("membership", &ClusterSNNGraphWalktrap_Result::membership);
+        .function("modularity", &js_bind<&ClusterSNNGraphWalktrap_Result::modularity>::fun)
+        .function("membership", &js_bind<&ClusterSNNGraphWalktrap_Result::membership>::fun);
 
-    emscripten::function("cluster_snn_graph_leiden", &cluster_snn_graph_leiden);
+    emscripten::function("cluster_snn_graph_leiden", &js_bind<&cluster_snn_graph_leiden>::fun);
 
     emscripten::class_<ClusterSNNGraphLeiden_Result>("ClusterSNNGraphLeiden_Result")
-        .function("modularity", &ClusterSNNGraphLeiden_Result::modularity)
-        .function("membership", &ClusterSNNGraphLeiden_Result::membership);
+        .function("modularity", &js_bind<&ClusterSNNGraphLeiden_Result::modularity>::fun)
+        .function("membership", &js_bind<&ClusterSNNGraphLeiden_Result::membership>::fun);
 }
 /**
  * @endcond
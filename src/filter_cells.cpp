@@ -1,6 +1,7 @@
 #include <emscripten/bind.h>
 #include "NumericMatrix.h"
 #include "scran/quality_control/FilterCells.hpp"
+#include "utils.h"
 #include <cstdint>
 
 /**
@@ -18,14 +19,14 @@ NumericMatrix filter_cells(const NumericMatrix& mat, uintptr_t filter, bool keep
     if (keep) {
         filterer.set_retain();
     }
-    return NumericMatrix(filterer.run(mat.ptr, reinterpret_cast<const uint8_t*>(filter)), mat.row_ids);
+    return mat.derive(filterer.run(mat.ptr, reinterpret_cast<const uint8_t*>(filter)));
 }
 
 /**
  * @cond 
  */
 EMSCRIPTEN_BINDINGS(filter_cells) {
-    emscripten::function("filter_cells", &filter_cells);
+    emscripten::function("filter_cells", &js_bind<&filter_cells>::fun);
 }
 /**
  * @endcond 
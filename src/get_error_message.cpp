@@ -1,6 +1,7 @@
 #include <emscripten/bind.h>
 #include <string>
 #include <stdexcept>
+#include "utils.h"
 
 /** 
  * Get the error message.
@@ -17,7 +18,7 @@ std::string get_error_message(intptr_t ptr) {
  * @cond
  */
 EMSCRIPTEN_BINDINGS(Bindings) {
-  emscripten::function("get_error_message", &get_error_message);
+  emscripten::function("get_error_message", &js_bind<&get_error_message>::fun);
 };
 /**
  * @endcond
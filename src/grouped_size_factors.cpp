@@ -22,10 +22,14 @@
  * This should be an entry in the array pointed to by `groups`. 
  * @param[out] output Offset to a double-precision array of length equal to the number of cells in `mat`,
  * to store the size factor for each cell.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
  * 
  * @return `output` is filled with the size factors for all cells in `mat`.
  */
-void grouped_size_factors(const NumericMatrix& mat, uintptr_t groups, bool center, double prior_count, int reference, uintptr_t output) {
+void grouped_size_factors(const NumericMatrix& mat, uintptr_t groups, bool center, double prior_count, int reference, uintptr_t output, int nthreads) {
+    ScopedExecutionContext scope(mat.execution_context(nthreads));
+
     scran::GroupedSizeFactors runner;
     runner.set_center(center).set_prior_count(prior_count); 
 
@@ -44,7 +48,7 @@ void grouped_size_factors(const NumericMatrix& mat, uintptr_t groups, bool cente
  * @cond
  */
 EMSCRIPTEN_BINDINGS(grouped_size_factors) {
-    emscripten::function("grouped_size_factors", &grouped_size_factors);
+    emscripten::function("grouped_size_factors", &js_bind<&grouped_size_factors>::fun);
 }
 /**
  * @endcond
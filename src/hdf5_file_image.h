@@ -0,0 +1,132 @@
+#ifndef HDF5_FILE_IMAGE_H
+#define HDF5_FILE_IMAGE_H
+
+#include "H5Cpp.h"
+
+#include <string>
+#include <stdexcept>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @file hdf5_file_image.h
+ *
+ * @brief Open a HDF5 file from a buffer on the Wasm heap.
+ */
+
+/**
+ * @brief HDF5 file opened from an in-memory file image.
+ *
+ * This uses the core driver with a set of file image callbacks that refer to the supplied buffer rather than copying it.
+ * In the browser, this means that an uploaded file only needs to be stored once on the Wasm heap,
+ * instead of being copied into the virtual filesystem and then (partially) copied again by the HDF5 library on every read.
+ * The file is opened in read-only mode, so the buffer is never modified by the HDF5 library.
+ *
+ * The buffer should not be modified or freed during the lifetime of this object.
+ * Instances cannot be copied or moved as the HDF5 library holds a pointer to the image details.
+ */
+class Hdf5FileImage {
+public:
+    /**
+     * @param buffer Pointer to the start of the file image.
+     * @param size Size of the file image, in bytes.
+     */
+    Hdf5FileImage(const void* buffer, size_t size) : image{ buffer, size }, handle(open(image)) {}
+
+    /**
+     * @param buffer Offset to the start of the file image on the Wasm heap.
+     * @param size Size of the file image, in bytes.
+     */
+    Hdf5FileImage(uintptr_t buffer, size_t size) : Hdf5FileImage(reinterpret_cast<const void*>(buffer), size) {}
+
+    Hdf5FileImage(const Hdf5FileImage&) = delete;
+    Hdf5FileImage& operator=(const Hdf5FileImage&) = delete;
+
+    /**
+     * @return Handle to the file.
+     */
+    const H5::H5File& file() const {
+        return handle;
+    }
+
+private:
+    struct Image {
+        const void* ptr;
+        size_t size;
+    };
+
+    Image image;
+    H5::H5File handle; // declared after the image so that the file is closed first.
+
+    // These callbacks follow the no-copy mode in H5LTopen_file_image(), which
+    // we don't call directly to avoid a dependency on the high-level library.
+    // Allocations just return the user's buffer, copies between the buffer and
+    // itself are no-ops, and nothing is ever freed or reallocated.
+    static void* image_malloc(size_t size, H5FD_file_image_op_t, void* udata) {
+        auto img = static_cast<Image*>(udata);
+        if (size != img->size) {
+            return NULL;
+        }
+        return const_cast<void*>(img->ptr);
+    }
+
+    static void* image_memcpy(void* dest, const void* src, size_t size, H5FD_file_image_op_t, void* udata) {
+        auto img = static_cast<Image*>(udata);
+        if (dest != img->ptr || src != img->ptr || size != img->size) {
+            return NULL;
+        }
+        return dest;
+    }
+
+    static void* image_realloc(void*, size_t, H5FD_file_image_op_t, void*) {
+        return NULL; // file is read-only, so it should never be resized.
+    }
+
+    static herr_t image_free(void*, H5FD_file_image_op_t, void*) {
+        return 0;
+    }
+
+    static void* udata_copy(void* udata) {
+        return udata;
+    }
+
+    static herr_t udata_free(void*) {
+        return 0;
+    }
+
+    static H5::H5File open(Image& img) {
+        if (img.ptr == NULL || img.size == 0) {
+            throw std::runtime_error("HDF5 file image should not be empty");
+        }
+
+        H5::FileAccPropList fapl;
+        fapl.setCore(img.size, false);
+
+        H5FD_file_image_callbacks_t callbacks = {
+            &image_malloc,
+            &image_memcpy,
+            &image_realloc,
+            &image_free,
+            &udata_copy,
+            &udata_free,
+            static_cast<void*>(&img)
+        };
+
+        // Callbacks must be set before the image so that the buffer is not copied into the property list.
+        if (H5Pset_file_image_callbacks(fapl.getId(), &callbacks) < 0) {
+            throw std::runtime_error("failed to set the callbacks for the HDF5 file image");
+        }
+        if (H5Pset_file_image(fapl.getId(), const_cast<void*>(img.ptr), img.size) < 0) {
+            throw std::runtime_error("failed to set the HDF5 file image");
+        }
+
+        // There's no backing store, but the core driver compares files by
+        // name, so each image needs a unique name to avoid being mistaken for
+        // another open image. This follows H5LTopen_file_image().
+        static std::atomic<unsigned long> counter(0);
+        std::string name = "file_image_" + std::to_string(counter++) + ".h5";
+        return H5::H5File(name, H5F_ACC_RDONLY, H5::FileCreatPropList::DEFAULT, fapl);
+    }
+};
+
+#endif
@@ -0,0 +1,802 @@
+#ifndef HDF5_LOADER_H
+#define HDF5_LOADER_H
+
+#include "H5Cpp.h"
+#include "zlib.h"
+#include "parallel.h"
+
+#include <vector>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <cstdint>
+
+/**
+ * @file hdf5_loader.h
+ *
+ * @brief Load (subsets of) HDF5 matrices into memory.
+ *
+ * Matrices are described in terms of their primary and secondary dimensions.
+ * For compressed sparse matrices, the primary dimension is the one that is compressed, e.g., columns for CSC matrices.
+ * For dense matrices, the primary dimension is the first dimension of the HDF5 dataset, i.e., the slowest-changing one.
+ * Each primary element can then be loaded with a contiguous read from the file.
+ *
+ * Reads are performed in large blocks that are aligned to the chunk boundaries of each dataset.
+ * This avoids many small reads, each of which would need to search the chunk index and possibly decompress a chunk that was already decompressed by a previous read.
+ *
+ * For compressed sparse matrices, the compressed chunks can also be read directly from the file and decompressed in parallel.
+ * This only uses one thread for the I/O (as the HDF5 library is not thread-safe) while the other threads inflate the chunks from the previous read.
+ */
+
+/**
+ * @brief Options for loading a matrix.
+ */
+struct Hdf5LoadOptions {
+    /**
+     * Size of the raw data chunk cache for each dataset, in bytes.
+     * This holds decompressed chunks that overlap multiple blocks.
+     */
+    size_t chunk_cache_size = 16000000;
+
+    /**
+     * Maximum size of each block to be read, in bytes.
+     * Larger blocks reduce the number of reads at the cost of memory usage.
+     * A block may be larger than this if a single primary element does not fit.
+     */
+    size_t block_size = 16000000;
+
+    /**
+     * Whether to read compressed chunks directly and decompress them in parallel.
+     * This is only used for datasets with DEFLATE compression and (optionally) the shuffle filter;
+     * all other datasets are read through the usual HDF5 filter pipeline.
+     */
+    bool direct_chunk_read = true;
+};
+
+/**
+ * @brief Statistics for reads from a HDF5 file, typically for tuning the options in `Hdf5LoadOptions`.
+ */
+struct Hdf5ReadStats {
+    /**
+     * Number of bytes read from the datasets.
+     * For regular reads, this is the uncompressed size of the requested data in the file;
+     * for direct chunk reads, this is the compressed size of the chunks.
+     */
+    double bytes = 0;
+
+    /**
+     * Number of calls to `H5Dread()` and `H5Dread_chunk()`.
+     */
+    double calls = 0;
+};
+
+/**
+ * @brief A compressed sparse matrix in memory.
+ *
+ * @tparam Value Type of the non-zero values.
+ * @tparam Index Type of the secondary indices.
+ */
+template<typename Value, typename Index>
+struct LoadedSparseMatrix {
+    /**
+     * Number of primary elements, after any subsetting.
+     */
+    size_t nprimary = 0;
+
+    /**
+     * Number of secondary elements, after any subsetting.
+     */
+    size_t nsecondary = 0;
+
+    /**
+     * Values of the non-zero elements.
+     */
+    std::vector<Value> values;
+
+    /**
+     * Secondary indices of the non-zero elements, sorted within each primary element.
+     */
+    std::vector<Index> indices;
+
+    /**
+     * Pointers to the start of each primary element in `values` and `indices`, of length `nprimary + 1`.
+     */
+    std::vector<size_t> pointers;
+};
+
+/**
+ * @cond
+ */
+template<typename T>
+const H5::PredType& hdf5_mem_type();
+
+template<>
+inline const H5::PredType& hdf5_mem_type<int>() { return H5::PredType::NATIVE_INT; }
+
+template<>
+inline const H5::PredType& hdf5_mem_type<double>() { return H5::PredType::NATIVE_DOUBLE; }
+
+template<>
+inline const H5::PredType& hdf5_mem_type<hsize_t>() { return H5::PredType::NATIVE_HSIZE; }
+
+inline void check_subset(const std::vector<int>& subset, size_t limit, const std::string& what) {
+    for (auto s : subset) {
+        if (s < 0 || static_cast<size_t>(s) >= limit) {
+            throw std::runtime_error(what + " subset indices should be non-negative and less than the number of " + what + "s");
+        }
+    }
+}
+
+inline H5::DataSet open_hdf5_dataset(const H5::Group& handle, const std::string& name, const Hdf5LoadOptions& options) {
+    // Using the recommended 100 slots per chunk that fits in the cache, with
+    // some arbitrary chunk size as we don't know it yet. w0 = 1 as we read
+    // sequentially, so fully-read chunks can be evicted first.
+    H5::DSetAccPropList dapl;
+    size_t nslots = std::max(static_cast<size_t>(521), options.chunk_cache_size / 10000);
+    dapl.setChunkCache(nslots, options.chunk_cache_size, 1.0);
+    return handle.openDataSet(name, dapl);
+}
+
+/*
+ * Length of the chunks along the first dimension, or 1 if the dataset is not
+ * chunked. Block boundaries are aligned to multiples of this length.
+ */
+inline hsize_t hdf5_chunk_length(const H5::DataSet& dhandle) {
+    auto cplist = dhandle.getCreatePlist();
+    if (cplist.getLayout() != H5D_CHUNKED) {
+        return 1;
+    }
+    int ndims = dhandle.getSpace().getSimpleExtentNdims();
+    std::vector<hsize_t> chunk_dims(ndims);
+    cplist.getChunk(ndims, chunk_dims.data());
+    return chunk_dims[0];
+}
+
+/*
+ * Reads the contiguous range [start, start + len) from a 1-dimensional
+ * dataset, or the rows [start, start + len) from a 2-dimensional dataset.
+ */
+template<typename T>
+void read_hdf5_range(const H5::DataSet& dhandle, hsize_t start, hsize_t len, T* buffer, Hdf5ReadStats& stats) {
+    auto dspace = dhandle.getSpace();
+    int ndims = dspace.getSimpleExtentNdims();
+    hsize_t dims[2];
+    dspace.getSimpleExtentDims(dims);
+
+    hsize_t offset[2] = { start, 0 };
+    hsize_t count[2] = { len, (ndims == 2 ? dims[1] : 1) };
+    dspace.selectHyperslab(H5S_SELECT_SET, count, offset);
+
+    H5::DataSpace mspace(ndims, count);
+    dhandle.read(buffer, hdf5_mem_type<T>(), mspace, dspace);
+
+    stats.bytes += static_cast<double>(count[0]) * count[1] * dhandle.getDataType().getSize();
+    ++stats.calls;
+}
+
+/*
+ * Decodes raw chunks of a 1-dimensional dataset, for use with direct chunk
+ * reads. Only DEFLATE and shuffle filters are supported, along with integer
+ * or floating-point types in little-endian order; 'supported' is false for
+ * anything else, in which case the usual H5Dread() should be used instead.
+ */
+class Hdf5ChunkDecoder {
+public:
+    Hdf5ChunkDecoder(const H5::DataSet& dhandle) {
+        auto cplist = dhandle.getCreatePlist();
+        if (cplist.getLayout() != H5D_CHUNKED || dhandle.getSpace().getSimpleExtentNdims() != 1) {
+            return;
+        }
+        cplist.getChunk(1, &chunk_length);
+
+        int nfilters = cplist.getNfilters();
+        for (int f = 0; f < nfilters; ++f) {
+            unsigned int flags;
+            size_t nelmts = 0;
+            unsigned int filter_config;
+            char name[64];
+            auto id = cplist.getFilter(f, flags, nelmts, NULL, sizeof(name), name, filter_config);
+            if (id == H5Z_FILTER_DEFLATE) {
+                deflate_index = f;
+            } else if (id == H5Z_FILTER_SHUFFLE && deflate_index < 0) { // shuffle must be applied before compression.
+                shuffle_index = f;
+            } else {
+                return;
+            }
+        }
+
+        auto tclass = dhandle.getTypeClass();
+        if (tclass == H5T_INTEGER) {
+            auto itype = dhandle.getIntType();
+            if (itype.getOrder() != H5T_ORDER_LE) {
+                return;
+            }
+            is_signed = (itype.getSign() != H5T_SGN_NONE);
+            type_size = itype.getSize();
+            if (type_size != 1 && type_size != 2 && type_size != 4 && type_size != 8) {
+                return;
+            }
+        } else if (tclass == H5T_FLOAT) {
+            auto ftype = dhandle.getFloatType();
+            if (ftype.getOrder() != H5T_ORDER_LE) {
+                return;
+            }
+            is_float = true;
+            type_size = ftype.getSize();
+            if (type_size != 4 && type_size != 8) {
+                return;
+            }
+        } else {
+            return;
+        }
+
+        supported = true;
+    }
+
+    bool supported = false;
+    hsize_t chunk_length = 0;
+
+    /*
+     * Decodes a raw chunk into 'output', which should have space for
+     * 'chunk_length' values. 'workspace' is used to store intermediate
+     * results and may be reused across calls.
+     */
+    template<typename T>
+    void decode(const unsigned char* raw, size_t nraw, uint32_t filter_mask, std::vector<unsigned char>& workspace, T* output) const {
+        size_t nbytes = chunk_length * type_size;
+        const unsigned char* current = raw;
+        size_t ncurrent = nraw;
+
+        if (deflate_index >= 0 && !(filter_mask & (1u << deflate_index))) {
+            workspace.resize(nbytes * (shuffle_index >= 0 ? 2 : 1));
+            uLongf dest_len = nbytes;
+            if (uncompress(workspace.data(), &dest_len, current, ncurrent) != Z_OK) {
+                throw std::runtime_error("failed to inflate a compressed chunk");
+            }
+            current = workspace.data();
+            ncurrent = dest_len;
+        }
+
+        if (ncurrent != nbytes) {
+            throw std::runtime_error("unexpected number of bytes in a decompressed chunk");
+        }
+
+        if (shuffle_index >= 0 && type_size > 1 && !(filter_mask & (1u << shuffle_index))) {
+            workspace.resize(nbytes * 2);
+            auto unshuffled = workspace.data() + nbytes;
+            for (size_t b = 0; b < type_size; ++b) {
+                auto src = current + b * chunk_length;
+                for (size_t i = 0; i < chunk_length; ++i) {
+                    unshuffled[i * type_size + b] = src[i];
+                }
+            }
+            current = unshuffled;
+        }
+
+        if (is_float) {
+            if (type_size == 4) {
+                convert<float>(current, output);
+            } else {
+                convert<double>(current, output);
+            }
+        } else if (is_signed) {
+            switch (type_size) {
+                case 1: convert<int8_t>(current, output); break;
+                case 2: convert<int16_t>(current, output); break;
+                case 4: convert<int32_t>(current, output); break;
+                default: convert<int64_t>(current, output); break;
+            }
+        } else {
+            switch (type_size) {
+                case 1: convert<uint8_t>(current, output); break;
+                case 2: convert<uint16_t>(current, output); break;
+                case 4: convert<uint32_t>(current, output); break;
+                default: convert<uint64_t>(current, output); break;
+            }
+        }
+    }
+
+private:
+    int deflate_index = -1, shuffle_index = -1;
+    bool is_float = false, is_signed = false;
+    size_t type_size = 0;
+
+    template<typename In, typename Out>
+    void convert(const unsigned char* src, Out* output) const {
+        for (size_t i = 0; i < chunk_length; ++i) {
+            In val;
+            std::memcpy(&val, src + i * sizeof(In), sizeof(In));
+            output[i] = val;
+        }
+    }
+};
+
+/*
+ * Compressed chunks overlapping a range of a 1-dimensional dataset, read with
+ * H5Dread_chunk(). This bypasses the filter pipeline, so the chunks can be
+ * decoded on any thread with Hdf5ChunkDecoder.
+ */
+struct Hdf5RawChunks {
+    std::vector<unsigned char> bytes;
+    std::vector<size_t> offsets; // start of each chunk in 'bytes', plus one past the end.
+    std::vector<uint32_t> masks;
+    hsize_t first_chunk = 0;
+
+    void fetch(const H5::DataSet& dhandle, hsize_t chunk_length, hsize_t start, hsize_t end, Hdf5ReadStats& stats) {
+        bytes.clear();
+        masks.clear();
+        offsets.clear();
+        offsets.push_back(0);
+        if (start >= end) {
+            return;
+        }
+
+        first_chunk = start / chunk_length;
+        hsize_t last_chunk = (end + chunk_length - 1) / chunk_length;
+        for (hsize_t c = first_chunk; c < last_chunk; ++c) {
+            hsize_t offset = c * chunk_length;
+            hsize_t nbytes;
+            if (H5Dget_chunk_storage_size(dhandle.getId(), &offset, &nbytes) < 0) {
+                throw std::runtime_error("failed to query the size of a chunk");
+            }
+
+            size_t current = bytes.size();
+            bytes.resize(current + nbytes);
+            uint32_t mask = 0;
+            if (nbytes && H5Dread_chunk(dhandle.getId(), H5P_DEFAULT, &offset, &mask, bytes.data() + current) < 0) {
+                throw std::runtime_error("failed to read a chunk directly");
+            }
+
+            masks.push_back(mask);
+            offsets.push_back(bytes.size());
+            stats.bytes += nbytes;
+            ++stats.calls;
+        }
+    }
+
+    size_t size() const {
+        return masks.size();
+    }
+
+    /*
+     * Decodes the chunk 'i' and copies its overlap with [start, end) into
+     * 'output', which holds values for the range starting at 'start'.
+     */
+    template<typename T>
+    void decode(size_t i, const Hdf5ChunkDecoder& decoder, hsize_t start, hsize_t end, std::vector<unsigned char>& workspace, std::vector<T>& scratch, T* output) const {
+        hsize_t chunk_start = (first_chunk + i) * decoder.chunk_length;
+        hsize_t from = std::max(chunk_start, start);
+        hsize_t to = std::min(chunk_start + decoder.chunk_length, end);
+
+        scratch.resize(decoder.chunk_length);
+        if (offsets[i] == offsets[i + 1]) { // unallocated chunk, assuming a fill value of zero.
+            std::fill(scratch.begin(), scratch.end(), 0);
+        } else {
+            decoder.decode(bytes.data() + offsets[i], offsets[i + 1] - offsets[i], masks[i], workspace, scratch.data());
+        }
+        std::copy(scratch.begin() + (from - chunk_start), scratch.begin() + (to - chunk_start), output + (from - start));
+    }
+};
+
+/*
+ * Groups the ranges for the requested primary elements into blocks that can
+ * be read with a single contiguous request. Block boundaries are aligned to
+ * multiples of 'unit' (i.e., the chunk length) and clamped to 'total'.
+ * Consecutive ranges are merged if they are no more than 'gap' apart after
+ * alignment, as long as the block does not exceed 'max_len'.
+ */
+struct PrimaryRun {
+    hsize_t start, end;
+    size_t first, last; // range of entries in the sorted order.
+};
+
+inline std::vector<PrimaryRun> define_runs(const std::vector<hsize_t>& starts, const std::vector<hsize_t>& ends, const std::vector<size_t>& order, 
+    hsize_t unit, hsize_t gap, hsize_t max_len, hsize_t total) 
+{
+    auto align_down = [&](hsize_t x) -> hsize_t { return (x / unit) * unit; };
+    auto align_up = [&](hsize_t x) -> hsize_t { return std::min(total, ((x + unit - 1) / unit) * unit); };
+
+    std::vector<PrimaryRun> runs;
+    for (size_t o = 0; o < order.size(); ++o) {
+        auto i = order[o];
+        auto start = align_down(starts[i]), end = align_up(ends[i]);
+
+        if (!runs.empty()) {
+            auto& last = runs.back();
+            auto new_end = std::max(last.end, end);
+            if (start <= last.end + gap && new_end - last.start <= max_len) {
+                last.end = new_end;
+                last.last = o + 1;
+                continue;
+            }
+        }
+
+        runs.push_back(PrimaryRun{ start, end, o, o + 1 });
+    }
+    return runs;
+}
+
+inline std::vector<size_t> sorted_order(const std::vector<int>& subset) {
+    std::vector<size_t> order(subset.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (!std::is_sorted(subset.begin(), subset.end())) {
+        std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) -> bool { return subset[l] < subset[r]; });
+    }
+    return order;
+}
+
+inline std::vector<int> full_subset(size_t n) {
+    std::vector<int> output(n);
+    std::iota(output.begin(), output.end(), 0);
+    return output;
+}
+
+/*
+ * Maps each secondary index to its position in the subset, or -1 if it is
+ * not present. Duplicates are not supported as each non-zero element can
+ * only be reported once per primary element.
+ */
+inline std::vector<int> secondary_mapping(const std::vector<int>& subset, size_t nsecondary, const std::string& what) {
+    std::vector<int> mapping(nsecondary, -1);
+    for (size_t s = 0; s < subset.size(); ++s) {
+        auto& current = mapping[subset[s]];
+        if (current != -1) {
+            throw std::runtime_error(what + " subset indices should be unique");
+        }
+        current = s;
+    }
+    return mapping;
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Load a compressed sparse matrix from a HDF5 group containing the `data`, `indices` and `indptr` datasets.
+ * Only the requested primary elements are read from the file via hyperslab selections.
+ *
+ * @tparam Value Type of the non-zero values.
+ * @tparam Index Type of the secondary indices.
+ *
+ * @param ghandle Handle to the group.
+ * @param nprimary Number of primary elements in the file.
+ * @param nsecondary Number of secondary elements in the file.
+ * @param primary_subset Pointer to the indices of the primary elements to load, in the desired order.
+ * If `NULL`, all primary elements are loaded.
+ * @param secondary_subset Pointer to the indices of the secondary elements to retain, in the desired order.
+ * These should be unique.
+ * If `NULL`, all secondary elements are retained.
+ * @param primary_name Name of the primary dimension, for error messages.
+ * @param secondary_name Name of the secondary dimension, for error messages.
+ * @param options Options for loading.
+ * @param stats Statistics for the reads, incremented by this function.
+ *
+ * @return The requested subset of the matrix in memory.
+ * The storage is allocated once for all non-zero elements of the requested primary elements, before any secondary subsetting.
+ */
+template<typename Value, typename Index>
+LoadedSparseMatrix<Value, Index> load_hdf5_compressed_sparse(
+    const H5::Group& ghandle,
+    size_t nprimary,
+    size_t nsecondary,
+    const std::vector<int>* primary_subset,
+    const std::vector<int>* secondary_subset,
+    const std::string& primary_name,
+    const std::string& secondary_name,
+    const Hdf5LoadOptions& options,
+    Hdf5ReadStats& stats)
+{
+    auto dhandle = open_hdf5_dataset(ghandle, "data", options);
+    auto ihandle = open_hdf5_dataset(ghandle, "indices", options);
+    auto phandle = ghandle.openDataSet("indptr");
+
+    hsize_t nnonzero;
+    {
+        auto dspace = dhandle.getSpace();
+        if (dspace.getSimpleExtentNdims() != 1) {
+            throw std::runtime_error("'data' should be a 1-dimensional dataset");
+        }
+        dspace.getSimpleExtentDims(&nnonzero);
+
+        auto ispace = ihandle.getSpace();
+        hsize_t ilen;
+        if (ispace.getSimpleExtentNdims() != 1 || (ispace.getSimpleExtentDims(&ilen), ilen != nnonzero)) {
+            throw std::runtime_error("'indices' should be a 1-dimensional dataset of the same length as 'data'");
+        }
+    }
+
+    {
+        auto pspace = phandle.getSpace();
+        hsize_t plen;
+        if (pspace.getSimpleExtentNdims() != 1 || (pspace.getSimpleExtentDims(&plen), plen != nprimary + 1)) {
+            throw std::runtime_error("'indptr' should be a 1-dimensional dataset of length equal to the number of " + primary_name + "s plus 1");
+        }
+    }
+
+    std::vector<int> all_primary;
+    if (primary_subset) {
+        check_subset(*primary_subset, nprimary, primary_name);
+    } else {
+        all_primary = full_subset(nprimary);
+        primary_subset = &all_primary;
+    }
+    const auto& psub = *primary_subset;
+    size_t nselected = psub.size();
+
+    // Only reading the 'indptr' entries that we need, via a point selection.
+    std::vector<hsize_t> starts(nselected), ends(nselected);
+    if (primary_subset == &all_primary) {
+        std::vector<hsize_t> ptrs(nprimary + 1);
+        phandle.read(ptrs.data(), H5::PredType::NATIVE_HSIZE);
+        stats.bytes += static_cast<double>(ptrs.size()) * phandle.getDataType().getSize();
+        ++stats.calls;
+        std::copy(ptrs.begin(), ptrs.end() - 1, starts.begin());
+        std::copy(ptrs.begin() + 1, ptrs.end(), ends.begin());
+
+    } else if (nselected) {
+        std::vector<hsize_t> needed;
+        needed.reserve(nselected * 2);
+        for (auto p : psub) {
+            needed.push_back(p);
+            needed.push_back(p + 1);
+        }
+        std::sort(needed.begin(), needed.end());
+        needed.resize(std::unique(needed.begin(), needed.end()) - needed.begin());
+
+        auto pspace = phandle.getSpace();
+        pspace.selectElements(H5S_SELECT_SET, needed.size(), needed.data());
+        hsize_t nneeded = needed.size();
+        H5::DataSpace mspace(1, &nneeded);
+        std::vector<hsize_t> ptrs(needed.size());
+        phandle.read(ptrs.data(), H5::PredType::NATIVE_HSIZE, mspace, pspace);
+        stats.bytes += static_cast<double>(ptrs.size()) * phandle.getDataType().getSize();
+        ++stats.calls;
+
+        auto lookup = [&](hsize_t i) -> hsize_t {
+            return ptrs[std::lower_bound(needed.begin(), needed.end(), i) - needed.begin()];
+        };
+        for (size_t s = 0; s < nselected; ++s) {
+            starts[s] = lookup(psub[s]);
+            ends[s] = lookup(psub[s] + 1);
+        }
+    }
+
+    for (size_t s = 0; s < nselected; ++s) {
+        if (starts[s] > ends[s]) {
+            throw std::runtime_error("'indptr' should be sorted in increasing order");
+        }
+        if (ends[s] > nnonzero) {
+            throw std::runtime_error("'indptr' should not exceed the length of 'data'");
+        }
+    }
+
+    std::vector<int> mapping;
+    if (secondary_subset) {
+        check_subset(*secondary_subset, nsecondary, secondary_name);
+        mapping = secondary_mapping(*secondary_subset, nsecondary, secondary_name);
+    }
+
+    LoadedSparseMatrix<Value, Index> output;
+    output.nprimary = nselected;
+    output.nsecondary = (secondary_subset ? secondary_subset->size() : nsecondary);
+
+    // The number of elements in each primary element is known from 'indptr',
+    // so each one is stored directly at its final position without any
+    // reallocation or reordering. With a secondary subset, this is an upper
+    // bound and the retained elements are compacted at the end.
+    output.pointers.resize(nselected + 1);
+    for (size_t s = 0; s < nselected; ++s) {
+        output.pointers[s + 1] = output.pointers[s] + (ends[s] - starts[s]);
+    }
+    output.values.resize(output.pointers.back());
+    output.indices.resize(output.pointers.back());
+    std::vector<size_t> retained;
+    if (secondary_subset) {
+        retained.resize(nselected);
+    }
+
+    // Loading in order of position in the file, so that we can merge adjacent
+    // ranges into a single read.
+    auto order = sorted_order(psub);
+    hsize_t unit = hdf5_chunk_length(dhandle);
+    hsize_t gap = (unit == 1 ? 4096 : 0); // allow some gap for contiguous datasets to avoid many small reads.
+    hsize_t element_size = dhandle.getDataType().getSize() + ihandle.getDataType().getSize();
+    hsize_t max_len = std::max<hsize_t>(1, options.block_size / element_size);
+    auto runs = define_runs(starts, ends, order, unit, gap, max_len, nnonzero);
+
+    std::vector<Value> vbuffer;
+    std::vector<int> ibuffer;
+    std::vector<std::pair<Index, Value> > sorter;
+
+    Hdf5ChunkDecoder ddecoder(dhandle), idecoder(ihandle);
+    bool direct = options.direct_chunk_read && ddecoder.supported && idecoder.supported;
+    Hdf5RawChunks draw, iraw, dnext, inext;
+    if (direct && !runs.empty()) {
+        draw.fetch(dhandle, ddecoder.chunk_length, runs.front().start, runs.front().end, stats);
+        iraw.fetch(ihandle, idecoder.chunk_length, runs.front().start, runs.front().end, stats);
+    }
+
+    for (size_t r = 0; r < runs.size(); ++r) {
+        const auto& run = runs[r];
+        hsize_t len = run.end - run.start;
+        vbuffer.resize(len);
+        ibuffer.resize(len);
+
+        if (direct) {
+            // Reading the chunks for the next run on this thread while the
+            // workers decompress the chunks for the current run.
+            auto io = [&]() -> void {
+                if (r + 1 < runs.size()) {
+                    const auto& next = runs[r + 1];
+                    dnext.fetch(dhandle, ddecoder.chunk_length, next.start, next.end, stats);
+                    inext.fetch(ihandle, idecoder.chunk_length, next.start, next.end, stats);
+                }
+            };
+
+            size_t ndchunks = draw.size();
+            run_parallel_with_io(io, ndchunks + iraw.size(), [&](int first, int last) -> void {
+                std::vector<unsigned char> workspace;
+                std::vector<Value> vscratch;
+                std::vector<int> iscratch;
+                for (int j = first; j < last; ++j) {
+                    if (static_cast<size_t>(j) < ndchunks) {
+                        draw.decode(j, ddecoder, run.start, run.end, workspace, vscratch, vbuffer.data());
+                    } else {
+                        iraw.decode(j - ndchunks, idecoder, run.start, run.end, workspace, iscratch, ibuffer.data());
+                    }
+                }
+            });
+
+            std::swap(draw, dnext);
+            std::swap(iraw, inext);
+
+        } else if (len) {
+            read_hdf5_range(dhandle, run.start, len, vbuffer.data(), stats);
+            read_hdf5_range(ihandle, run.start, len, ibuffer.data(), stats);
+        }
+
+        for (size_t o = run.first; o < run.last; ++o) {
+            auto i = order[o];
+            size_t first = starts[i] - run.start, last = ends[i] - run.start;
+
+            for (size_t j = first; j < last; ++j) {
+                auto idx = ibuffer[j];
+                if (idx < 0 || static_cast<size_t>(idx) >= nsecondary) {
+                    throw std::runtime_error("'indices' should be non-negative and less than the number of " + secondary_name + "s");
+                }
+            }
+
+            auto offset = output.pointers[i];
+            if (secondary_subset) {
+                sorter.clear();
+                for (size_t j = first; j < last; ++j) {
+                    auto target = mapping[ibuffer[j]];
+                    if (target >= 0) {
+                        sorter.emplace_back(target, vbuffer[j]);
+                    }
+                }
+                std::sort(sorter.begin(), sorter.end());
+                for (size_t k = 0; k < sorter.size(); ++k) {
+                    output.indices[offset + k] = sorter[k].first;
+                    output.values[offset + k] = sorter[k].second;
+                }
+                retained[i] = sorter.size();
+            } else {
+                std::copy(ibuffer.begin() + first, ibuffer.begin() + last, output.indices.begin() + offset);
+                std::copy(vbuffer.begin() + first, vbuffer.begin() + last, output.values.begin() + offset);
+            }
+        }
+    }
+
+    if (secondary_subset) {
+        // Shifting each primary element forward over the discarded elements.
+        // This is done in place, as no element moves past its original position.
+        size_t current = 0;
+        for (size_t s = 0; s < nselected; ++s) {
+            auto first = output.pointers[s];
+            output.pointers[s] = current;
+            std::copy(output.indices.begin() + first, output.indices.begin() + first + retained[s], output.indices.begin() + current);
+            std::copy(output.values.begin() + first, output.values.begin() + first + retained[s], output.values.begin() + current);
+            current += retained[s];
+        }
+        output.pointers[nselected] = current;
+        output.indices.resize(current);
+        output.values.resize(current);
+    }
+
+    return output;
+}
+
+/**
+ * Load a dense matrix from a 2-dimensional HDF5 dataset.
+ * Only the requested primary elements (i.e., rows of the dataset) are read from the file via hyperslab selections.
+ *
+ * @tparam Value Type of the values.
+ *
+ * @param handle Handle to the file or group containing the dataset.
+ * @param name Name of the dataset.
+ * @param primary_subset Pointer to the indices of the primary elements to load, in the desired order.
+ * If `NULL`, all primary elements are loaded.
+ * @param secondary_subset Pointer to the indices of the secondary elements to retain, in the desired order.
+ * If `NULL`, all secondary elements are retained.
+ * @param primary_name Name of the primary dimension, for error messages.
+ * @param secondary_name Name of the secondary dimension, for error messages.
+ * @param options Options for loading.
+ * @param stats Statistics for the reads, incremented by this function.
+ *
+ * @return Vector of length equal to the product of the number of loaded primary and secondary elements.
+ * Values for each primary element are stored contiguously.
+ */
+template<typename Value>
+std::vector<Value> load_hdf5_dense(
+    const H5::Group& handle,
+    const std::string& name,
+    const std::vector<int>* primary_subset,
+    const std::vector<int>* secondary_subset,
+    const std::string& primary_name,
+    const std::string& secondary_name,
+    const Hdf5LoadOptions& options,
+    Hdf5ReadStats& stats)
+{
+    auto dhandle = open_hdf5_dataset(handle, name, options);
+    auto dspace = dhandle.getSpace();
+    if (dspace.getSimpleExtentNdims() != 2) {
+        throw std::runtime_error("dense matrix dataset should be 2-dimensional");
+    }
+    hsize_t dims[2];
+    dspace.getSimpleExtentDims(dims);
+    size_t nprimary = dims[0], nsecondary = dims[1];
+
+    std::vector<int> all_primary;
+    if (primary_subset) {
+        check_subset(*primary_subset, nprimary, primary_name);
+    } else {
+        all_primary = full_subset(nprimary);
+        primary_subset = &all_primary;
+    }
+    if (secondary_subset) {
+        check_subset(*secondary_subset, nsecondary, secondary_name);
+    }
+
+    const auto& psub = *primary_subset;
+    size_t nselected = psub.size();
+    size_t nretained = (secondary_subset ? secondary_subset->size() : nsecondary);
+    std::vector<Value> output(nselected * nretained);
+
+    std::vector<hsize_t> starts(psub.begin(), psub.end()), ends(nselected);
+    for (size_t s = 0; s < nselected; ++s) {
+        ends[s] = starts[s] + 1;
+    }
+    auto order = sorted_order(psub);
+    hsize_t unit = hdf5_chunk_length(dhandle);
+    hsize_t gap = (unit == 1 ? 16 : 0);
+    hsize_t row_size = std::max<hsize_t>(1, nsecondary * dhandle.getDataType().getSize());
+    hsize_t max_len = std::max<hsize_t>(1, options.block_size / row_size);
+    auto runs = define_runs(starts, ends, order, unit, gap, max_len, nprimary);
+
+    std::vector<Value> buffer;
+    for (const auto& run : runs) {
+        buffer.resize((run.end - run.start) * nsecondary);
+        read_hdf5_range(dhandle, run.start, run.end - run.start, buffer.data(), stats);
+
+        for (size_t o = run.first; o < run.last; ++o) {
+            auto i = order[o];
+            auto src = buffer.begin() + (starts[i] - run.start) * nsecondary;
+            auto dest = output.begin() + i * nretained;
+            if (secondary_subset) {
+                for (auto s : *secondary_subset) {
+                    *dest = src[s];
+                    ++dest;
+                }
+            } else {
+                std::copy(src, src + nsecondary, dest);
+            }
+        }
+    }
+
+    return output;
+}
+
+#endif
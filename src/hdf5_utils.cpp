@@ -1,6 +1,8 @@
 #include <emscripten.h>
 #include <emscripten/bind.h>
 #include "H5Cpp.h"
+#include "hdf5_file_image.h"
+#include "utils.h"
 #include <vector>
 #include <string>
 #include <cstdint>
@@ -22,6 +24,23 @@ struct H5GroupDetails {
      */
     H5GroupDetails(std::string file, std::string name) {
         H5::H5File handle(file, H5F_ACC_RDONLY);
+        fill(handle, name);
+    }
+
+    /**
+     * @param buffer Offset to a `uint8_t` array containing the contents of a HDF5 file, see `Hdf5FileImage`.
+     * @param size Length of the array in `buffer`.
+     * @param name Name of a group inside the file.
+     */
+    H5GroupDetails(uintptr_t buffer, size_t size, std::string name) {
+        Hdf5FileImage image(buffer, size);
+        fill(image.file(), name);
+    }
+
+    /**
+     * @cond
+     */
+    void fill(const H5::H5File& handle, const std::string& name) {
         H5::Group ghandle = handle.openGroup(name);
 
         std::vector<std::string> collected;
@@ -57,6 +76,9 @@ struct H5GroupDetails {
             }
         }
     }
+    /**
+     * @endcond
+     */
 
     /**
      * @return An `Uint8Array` view containing the concatenated names of all objects inside the file.
@@ -145,6 +167,23 @@ struct H5DataSetDetails {
      */
     H5DataSetDetails(std::string file, std::string name) {
         H5::H5File handle(file, H5F_ACC_RDONLY);
+        fill(handle, name);
+    }
+
+    /**
+     * @param buffer Offset to a `uint8_t` array containing the contents of a HDF5 file, see `Hdf5FileImage`.
+     * @param size Length of the array in `buffer`.
+     * @param name Name of a dataset inside the file.
+     */
+    H5DataSetDetails(uintptr_t buffer, size_t size, std::string name) {
+        Hdf5FileImage image(buffer, size);
+        fill(image.file(), name);
+    }
+
+    /**
+     * @cond
+     */
+    void fill(const H5::H5File& handle, const std::string& name) {
         auto dhandle = handle.openDataSet(name);
 
         auto dtype = dhandle.getDataType();
@@ -158,6 +197,9 @@ struct H5DataSetDetails {
 
         return;
     }
+    /**
+     * @endcond
+     */
 
     /**
      * @return Type of the dataset - `"string"`, `"integer"`, `"float"` or `"other"`.
@@ -273,100 +315,122 @@ struct LoadedH5DataSet {
     LoadedH5DataSet(std::string path, std::string name) {
         try {
             H5::H5File handle(path, H5F_ACC_RDONLY);
+            fill(handle, name);
+        } catch (H5::Exception& e) {
+            throw std::runtime_error(e.getCDetailMsg());
+        }
+    }
 
-            auto dhandle = handle.openDataSet(name);
-            auto dspace = dhandle.getSpace();
-            auto dtype = dhandle.getDataType();
-            type_ = guess_hdf5_type(dhandle, dtype);
+    /**
+     * @param buffer Offset to a `uint8_t` array containing the contents of a HDF5 file, see `Hdf5FileImage`.
+     * @param size Length of the array in `buffer`.
+     * @param name Name of a dataset inside the HDF5 file.
+     */
+    LoadedH5DataSet(uintptr_t buffer, size_t size, std::string name) {
+        try {
+            Hdf5FileImage image(buffer, size);
+            fill(image.file(), name);
+        } catch (H5::Exception& e) {
+            throw std::runtime_error(e.getCDetailMsg());
+        }
+    }
 
-            int ndims = dspace.getSimpleExtentNdims();
-            std::vector<hsize_t> dims(ndims);
-            dspace.getSimpleExtentDims(dims.data());
-            shape_.insert(shape_.end(), dims.begin(), dims.end());
+    /**
+     * @cond
+     */
+    void fill(const H5::H5File& handle, const std::string& name) {
+        auto dhandle = handle.openDataSet(name);
+        auto dspace = dhandle.getSpace();
+        auto dtype = dhandle.getDataType();
+        type_ = guess_hdf5_type(dhandle, dtype);
 
-            hsize_t full_length = 1;
-            for (auto d : dims) {
-                full_length *= d;
-            }
+        int ndims = dspace.getSimpleExtentNdims();
+        std::vector<hsize_t> dims(ndims);
+        dspace.getSimpleExtentDims(dims.data());
+        shape_.insert(shape_.end(), dims.begin(), dims.end());
+
+        hsize_t full_length = 1;
+        for (auto d : dims) {
+            full_length *= d;
+        }
+
+        if (type_ == "Uint8") {
+            u8_data.resize(full_length);
+            dhandle.read(u8_data.data(), H5::PredType::NATIVE_UINT8);
+
+        } else if (type_ == "Int8") {
+            i8_data.resize(full_length);
+            dhandle.read(i8_data.data(), H5::PredType::NATIVE_INT8);
+
+        } else if (type_ == "Uint16") {
+            u16_data.resize(full_length);
+            dhandle.read(u16_data.data(), H5::PredType::NATIVE_UINT16);
+
+        } else if (type_ == "Int16") {
+            i16_data.resize(full_length);
+            dhandle.read(i16_data.data(), H5::PredType::NATIVE_INT16);
+
+        } else if (type_ == "Uint32") {
+            u32_data.resize(full_length);
+            dhandle.read(u32_data.data(), H5::PredType::NATIVE_UINT32);
+
+        } else if (type_ == "Int32") {
+            i32_data.resize(full_length);
+            dhandle.read(i32_data.data(), H5::PredType::NATIVE_INT32);
+
+        } else if (type_ == "Uint64") {
+            u64_data.resize(full_length);
+            dhandle.read(u64_data.data(), H5::PredType::NATIVE_DOUBLE); // see comments above about embind.
+
+        } else if (type_ == "Int64") {
+            i64_data.resize(full_length);
+            dhandle.read(i64_data.data(), H5::PredType::NATIVE_DOUBLE); // see comments above about embind.
+
+        } else if (type_ == "Float32") {
+            f32_data.resize(full_length);
+            dhandle.read(f32_data.data(), H5::PredType::NATIVE_FLOAT);
+
+        } else if (type_ == "Float64") {
+            f64_data.resize(full_length);
+            dhandle.read(f64_data.data(), H5::PredType::NATIVE_DOUBLE);
+
+        } else if (type_ == "String") {
+            lengths_.resize(full_length);
+
+            if (dtype.isVariableStr()) {
+                std::vector<char*> buffer(full_length);
+                dhandle.read(buffer.data(), dtype);
 
-            if (type_ == "Uint8") {
-                u8_data.resize(full_length);
-                dhandle.read(u8_data.data(), H5::PredType::NATIVE_UINT8);
-
-            } else if (type_ == "Int8") {
-                i8_data.resize(full_length);
-                dhandle.read(i8_data.data(), H5::PredType::NATIVE_INT8);
-
-            } else if (type_ == "Uint16") {
-                u16_data.resize(full_length);
-                dhandle.read(u16_data.data(), H5::PredType::NATIVE_UINT16);
-
-            } else if (type_ == "Int16") {
-                i16_data.resize(full_length);
-                dhandle.read(i16_data.data(), H5::PredType::NATIVE_INT16);
-
-            } else if (type_ == "Uint32") {
-                u32_data.resize(full_length);
-                dhandle.read(u32_data.data(), H5::PredType::NATIVE_UINT32);
-
-            } else if (type_ == "Int32") {
-                i32_data.resize(full_length);
-                dhandle.read(i32_data.data(), H5::PredType::NATIVE_INT32);
-
-            } else if (type_ == "Uint64") {
-                u64_data.resize(full_length);
-                dhandle.read(u64_data.data(), H5::PredType::NATIVE_DOUBLE); // see comments above about embind.
-
-            } else if (type_ == "Int64") {
-                i64_data.resize(full_length);
-                dhandle.read(i64_data.data(), H5::PredType::NATIVE_DOUBLE); // see comments above about embind.
-
-            } else if (type_ == "Float32") {
-                f32_data.resize(full_length);
-                dhandle.read(f32_data.data(), H5::PredType::NATIVE_FLOAT);
-
-            } else if (type_ == "Float64") {
-                f64_data.resize(full_length);
-                dhandle.read(f64_data.data(), H5::PredType::NATIVE_DOUBLE);
-
-            } else if (type_ == "String") {
-                lengths_.resize(full_length);
-
-                if (dtype.isVariableStr()) {
-                    std::vector<char*> buffer(full_length);
-                    dhandle.read(buffer.data(), dtype);
-
-                    str_data.reserve(full_length); // guessing that each string is of at least length 1.
-                    for (size_t i = 0; i < full_length; ++i) {
-                        std::string current(buffer[i]);
-                        lengths_[i] = current.size();
-                        str_data.insert(str_data.end(), current.begin(), current.end());
-                    }
-
-                    H5Dvlen_reclaim(dtype.getId(), dspace.getId(), H5P_DEFAULT, buffer.data());
-
-                } else {
-                    size_t len = dtype.getSize();
-                    std::vector<char> buffer(len * full_length);
-                    dhandle.read(buffer.data(), dtype);
-
-                    str_data.reserve(buffer.size()); // guessing that each string is of length 'len'.
-                    auto start = buffer.data();
-                    for (size_t i = 0; i < full_length; ++i, start += len) {
-                        size_t j = 0;
-                        for (; j < len && start[j] != '\0'; ++j) {}
-                        lengths_[i] = j;
-                        str_data.insert(str_data.end(), start, start + j);
-                    }
+                str_data.reserve(full_length); // guessing that each string is of at least length 1.
+                for (size_t i = 0; i < full_length; ++i) {
+                    std::string current(buffer[i]);
+                    lengths_[i] = current.size();
+                    str_data.insert(str_data.end(), current.begin(), current.end());
                 }
-            }
 
-        } catch (H5::Exception& e) {
-            throw std::runtime_error(e.getCDetailMsg());
+                H5Dvlen_reclaim(dtype.getId(), dspace.getId(), H5P_DEFAULT, buffer.data());
+
+            } else {
+                size_t len = dtype.getSize();
+                std::vector<char> buffer(len * full_length);
+                dhandle.read(buffer.data(), dtype);
+
+                str_data.reserve(buffer.size()); // guessing that each string is of length 'len'.
+                auto start = buffer.data();
+                for (size_t i = 0; i < full_length; ++i, start += len) {
+                    size_t j = 0;
+                    for (; j < len && start[j] != '\0'; ++j) {}
+                    lengths_[i] = j;
+                    str_data.insert(str_data.end(), start, start + j);
+                }
+            }
         }
 
         return;
     }
+    /**
+     * @endcond
+     */
 };
 
 /**
@@ -506,31 +570,34 @@ void write_string_hdf5_dataset(std::string path, std::string name, size_t n, uin
  */
 EMSCRIPTEN_BINDINGS(hdf5_utils) {
     emscripten::class_<H5GroupDetails>("H5GroupDetails")
-        .constructor<std::string, std::string>()
-        .function("buffer", &H5GroupDetails::buffer)
-        .function("lengths", &H5GroupDetails::lengths)
-        .function("types", &H5GroupDetails::types)
+        .constructor(&js_construct<H5GroupDetails, std::string, std::string>, emscripten::allow_raw_pointers())
+        .constructor(&js_construct<H5GroupDetails, uintptr_t, size_t, std::string>, emscripten::allow_raw_pointers())
+        .function("buffer", &js_bind<&H5GroupDetails::buffer>::fun)
+        .function("lengths", &js_bind<&H5GroupDetails::lengths>::fun)
+        .function("types", &js_bind<&H5GroupDetails::types>::fun)
         ;
 
     emscripten::class_<H5DataSetDetails>("H5DataSetDetails")
-        .constructor<std::string, std::string>()
-        .function("type", &H5DataSetDetails::type)
-        .function("shape", &H5DataSetDetails::shape)
+        .constructor(&js_construct<H5DataSetDetails, std::string, std::string>, emscripten::allow_raw_pointers())
+        .constructor(&js_construct<H5DataSetDetails, uintptr_t, size_t, std::string>, emscripten::allow_raw_pointers())
+        .function("type", &js_bind<&H5DataSetDetails::type>::fun)
+        .function("shape", &js_bind<&H5DataSetDetails::shape>::fun)
         ;
 
     emscripten::class_<LoadedH5DataSet>("LoadedH5DataSet")
-        .constructor<std::string, std::string>()
-        .function("type", &LoadedH5DataSet::type)
-        .function("shape", &LoadedH5DataSet::shape)
-        .function("values", &LoadedH5DataSet::values)
-        .function("lengths", &LoadedH5DataSet::lengths)
+        .constructor(&js_construct<LoadedH5DataSet, std::string, std::string>, emscripten::allow_raw_pointers())
+        .constructor(&js_construct<LoadedH5DataSet, uintptr_t, size_t, std::string>, emscripten::allow_raw_pointers())
+        .function("type", &js_bind<&LoadedH5DataSet::type>::fun)
+        .function("shape", &js_bind<&LoadedH5DataSet::shape>::fun)
+        .function("values", &js_bind<&LoadedH5DataSet::values>::fun)
+        .function("lengths", &js_bind<&LoadedH5DataSet::lengths>::fun)
         ;
 
-   emscripten::function("create_hdf5_file", &create_hdf5_file);
-   emscripten::function("create_hdf5_dataset", &create_hdf5_dataset);
-   emscripten::function("create_hdf5_group", &create_hdf5_group);
-   emscripten::function("write_numeric_hdf5_dataset", &write_numeric_hdf5_dataset);
-   emscripten::function("write_string_hdf5_dataset", &write_string_hdf5_dataset);
+   emscripten::function("create_hdf5_file", &js_bind<&create_hdf5_file>::fun);
+   emscripten::function("create_hdf5_dataset", &js_bind<&create_hdf5_dataset>::fun);
+   emscripten::function("create_hdf5_group", &js_bind<&create_hdf5_group>::fun);
+   emscripten::function("write_numeric_hdf5_dataset", &js_bind<&write_numeric_hdf5_dataset>::fun);
+   emscripten::function("write_string_hdf5_dataset", &js_bind<&write_string_hdf5_dataset>::fun);
 }
 /**
  * @endcond
@@ -3,6 +3,11 @@
 #include "tatami/ext/convert_to_layered_sparse.hpp"
 #include "tatami/ext/SomeNumericArray.hpp"
 #include "utils.h"
+#include "JSVector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 
 /**
  * @cond
@@ -47,16 +52,49 @@ tatami::SomeNumericArray<T> create_SomeNumericArray(uintptr_t ptr, size_t len, s
  * @param[in] values Offset to an integer array of length `nrows*ncols` containing the contents of the matrix.
  * This is assumed to be in column-major format.
  * @param type Type of the `values` array, as the name of a TypedArray subclass.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
  *
  * @return A `NumericMatrix` containing a layered sparse matrix.
  */
-NumericMatrix initialize_sparse_matrix_from_dense_vector(size_t nrows, size_t ncols, uintptr_t values, std::string type) {
+NumericMatrix initialize_sparse_matrix_from_dense_vector(size_t nrows, size_t ncols, uintptr_t values, std::string type, int nthreads) {
+    ScopedExecutionContext scope{ ExecutionContext(nthreads) };
+
     auto vals = create_SomeNumericArray<int>(values, nrows*ncols, type);
     tatami::DenseColumnMatrix<double, int, decltype(vals)> mat(nrows, ncols, vals);
     auto output = tatami::convert_to_layered_sparse(&mat); 
     return NumericMatrix(std::move(output.matrix), permutation_to_indices(output.permutation));
 }
 
+/**
+ * @cond
+ */
+template<typename T>
+std::vector<T> copy_SomeNumericArray(uintptr_t ptr, size_t len, const std::string& type) {
+    auto arr = create_SomeNumericArray<T>(ptr, len, type);
+    std::vector<T> output(len);
+    std::copy(arr.begin(), arr.end(), output.begin());
+    return output;
+}
+
+template<typename T, bool ROW>
+NumericMatrix create_compressed_sparse_matrix(size_t nrows, size_t ncols, size_t nelements, 
+    uintptr_t values, const std::string& value_type,
+    uintptr_t indices, const std::string& index_type,
+    uintptr_t indptrs, const std::string& indptr_type)
+{
+    auto val = copy_SomeNumericArray<T>(values, nelements, value_type);
+    auto idx = copy_SomeNumericArray<int>(indices, nelements, index_type);
+    auto ind = copy_SomeNumericArray<size_t>(indptrs, (ROW ? nrows : ncols) + 1, indptr_type);
+
+    typedef tatami::CompressedSparseMatrix<ROW, double, int, decltype(val), decltype(idx), decltype(ind)> Matrix;
+    auto ptr = std::shared_ptr<const tatami::NumericMatrix>(new Matrix(nrows, ncols, std::move(val), std::move(idx), std::move(ind)));
+    return NumericMatrix(std::move(ptr));
+}
+/**
+ * @endcond
+ */
+
 /**
  * @param nrows Number of rows.
  * @param ncols Number of columns.
@@ -69,15 +107,43 @@ NumericMatrix initialize_sparse_matrix_from_dense_vector(size_t nrows, size_t nc
  * @param indptr_type Type of the `indptrs` array, as the name of a TypedArray subclass.
  * @param csc Are the inputs in compressed sparse column format?
  * Set to `false` for data in the compressed sparse row format.
+ * @param layered Whether to convert the matrix into a layered sparse matrix.
+ * This requires all values to be non-negative integers.
+ * If `false`, the values are stored as-is in a compressed sparse matrix, which is useful for non-integer data.
+ * @param float32 Whether to store the values in single precision when `layered = false`.
+ * This halves the memory usage at the cost of some precision; values are still extracted as `double`s.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
  *
- * @return A `NumericMatrix` containing a layered sparse matrix.
+ * @return A `NumericMatrix` containing a sparse matrix.
  */
 NumericMatrix initialize_sparse_matrix(size_t nrows, size_t ncols, size_t nelements, 
     uintptr_t values, std::string value_type,
     uintptr_t indices, std::string index_type,
     uintptr_t indptrs, std::string indptr_type,
-    bool csc)
+    bool csc,
+    bool layered,
+    bool float32,
+    int nthreads)
 {
+    ScopedExecutionContext scope{ ExecutionContext(nthreads) };
+
+    if (!layered) {
+        if (float32) {
+            if (csc) {
+                return create_compressed_sparse_matrix<float, false>(nrows, ncols, nelements, values, value_type, indices, index_type, indptrs, indptr_type);
+            } else {
+                return create_compressed_sparse_matrix<float, true>(nrows, ncols, nelements, values, value_type, indices, index_type, indptrs, indptr_type);
+            }
+        } else {
+            if (csc) {
+                return create_compressed_sparse_matrix<double, false>(nrows, ncols, nelements, values, value_type, indices, index_type, indptrs, indptr_type);
+            } else {
+                return create_compressed_sparse_matrix<double, true>(nrows, ncols, nelements, values, value_type, indices, index_type, indptrs, indptr_type);
+            }
+        }
+    }
+
     auto val = create_SomeNumericArray<int>(values, nelements, value_type);
     auto idx = create_SomeNumericArray<int>(indices, nelements, index_type);
 
@@ -95,32 +161,80 @@ NumericMatrix initialize_sparse_matrix(size_t nrows, size_t ncols, size_t neleme
     return NumericMatrix(std::move(output.matrix), permutation_to_indices(output.permutation));
 }
 
+/**
+ * @cond
+ */
+template<typename T>
+NumericMatrix create_dense_matrix(size_t nrows, size_t ncols, uintptr_t values) {
+    auto vptr = reinterpret_cast<const T*>(values);
+    std::vector<T> tmp(vptr, vptr + nrows * ncols);
+    auto ptr = std::shared_ptr<const tatami::NumericMatrix>(new tatami::DenseColumnMatrix<double, int, std::vector<T> >(nrows, ncols, std::move(tmp)));
+    return NumericMatrix(std::move(ptr));
+}
+/**
+ * @endcond
+ */
+
 /**
  * @param nrows Number of rows.
  * @param ncols Number of columns.
- * @param[in] values Offset to an integer array of length `nrows*ncols` containing the contents of the matrix.
+ * @param[in] values Offset to an array of length `nrows*ncols` containing the contents of the matrix.
  * This is assumed to be in column-major format.
  * @param type Type of the `values` array, as the name of a TypedArray subclass.
+ * @param borrow Whether to refer to `values` directly rather than copying it.
+ * Only supported for `Float64Array` inputs, in which case `values` must outlive the returned `NumericMatrix` and any of its clones.
+ * @param float32 Whether to store double-precision inputs in single precision.
+ * This halves the memory usage at the cost of some precision; values are still extracted as `double`s.
+ * Ignored if `borrow = true`.
  *
  * @return A `NumericMatrix` containing a dense matrix.
+ * If `borrow = false`, values are stored in their original type to avoid widening narrow inputs to `double`s.
  */
-NumericMatrix initialize_dense_matrix(size_t nrows, size_t ncols, uintptr_t values, std::string type) {
-    std::vector<double> tmp(nrows* ncols);
-    auto vals = create_SomeNumericArray<double>(values, nrows*ncols, type);
-    std::copy(vals.begin(), vals.end(), tmp.begin());
-    auto ptr = std::shared_ptr<const tatami::NumericMatrix>(new tatami::DenseColumnMatrix<double, int>(nrows, ncols, std::move(tmp)));
-    return NumericMatrix(std::move(ptr));
+NumericMatrix initialize_dense_matrix(size_t nrows, size_t ncols, uintptr_t values, std::string type, bool borrow, bool float32) {
+    if (borrow) {
+        if (type != "Float64Array") {
+            throw std::runtime_error("borrowing is only supported for 'Float64Array' inputs");
+        }
+        JSVector<double> thing(reinterpret_cast<const double*>(values), nrows * ncols);
+        auto ptr = std::shared_ptr<const tatami::NumericMatrix>(new tatami::DenseColumnMatrix<double, int, decltype(thing)>(nrows, ncols, thing));
+        return NumericMatrix(std::move(ptr));
+    }
+
+    if (type == "Int8Array") {
+        return create_dense_matrix<int8_t>(nrows, ncols, values);
+    } else if (type == "Uint8Array") {
+        return create_dense_matrix<uint8_t>(nrows, ncols, values);
+    } else if (type == "Int16Array") {
+        return create_dense_matrix<int16_t>(nrows, ncols, values);
+    } else if (type == "Uint16Array") {
+        return create_dense_matrix<uint16_t>(nrows, ncols, values);
+    } else if (type == "Int32Array") {
+        return create_dense_matrix<int32_t>(nrows, ncols, values);
+    } else if (type == "Uint32Array") {
+        return create_dense_matrix<uint32_t>(nrows, ncols, values);
+    } else if (type == "Float32Array") {
+        return create_dense_matrix<float>(nrows, ncols, values);
+    } else if (type == "Float64Array" || type == "BigInt64Array" || type == "BigUint64Array") { // see create_SomeNumericArray() for the BigInt aliasing.
+        if (float32) {
+            auto vals = copy_SomeNumericArray<float>(values, nrows * ncols, type);
+            auto ptr = std::shared_ptr<const tatami::NumericMatrix>(new tatami::DenseColumnMatrix<double, int, decltype(vals)>(nrows, ncols, std::move(vals)));
+            return NumericMatrix(std::move(ptr));
+        }
+        return create_dense_matrix<double>(nrows, ncols, values);
+    }
+
+    throw std::runtime_error("unknown array type '" + type + "'");
 }
 
 /**
  * @cond
  */
 EMSCRIPTEN_BINDINGS(initialize_sparse_matrix) {
-    emscripten::function("initialize_sparse_matrix", &initialize_sparse_matrix);
+    emscripten::function("initialize_sparse_matrix", &js_bind<&initialize_sparse_matrix>::fun);
 
-    emscripten::function("initialize_sparse_matrix_from_dense_vector", &initialize_sparse_matrix_from_dense_vector);
+    emscripten::function("initialize_sparse_matrix_from_dense_vector", &js_bind<&initialize_sparse_matrix_from_dense_vector>::fun);
 
-    emscripten::function("initialize_dense_matrix", &initialize_dense_matrix);
+    emscripten::function("initialize_dense_matrix", &js_bind<&initialize_dense_matrix>::fun);
 }
 /**
  * @endcond
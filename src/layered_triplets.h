@@ -0,0 +1,439 @@
+#ifndef LAYERED_TRIPLETS_H
+#define LAYERED_TRIPLETS_H
+
+#include "NumericMatrix.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+
+/**
+ * @file layered_triplets.h
+ *
+ * @brief Construction of a layered sparse matrix from its non-zero elements.
+ */
+
+/**
+ * @brief Blocks of a layered sparse matrix, filled directly from the non-zero elements.
+ *
+ * The layered representation stores each row in the smallest unsigned integer type that can hold its largest count.
+ * Rows are also split into blocks of up to 65536 rows so that row indices can be stored as 16-bit integers.
+ * This usually requires 3-4 bytes per non-zero element, compared to 12 bytes for a conventional compressed sparse matrix of `double`s.
+ *
+ * Given the maximum of each row, the non-zero elements are passed to `count()`, then to `fill()` after calling `allocate()`.
+ * These methods can be called concurrently as long as each combination of block and column is only used by one thread.
+ * Elements of a column should be passed to `fill()` in increasing order of their rows, otherwise `build()` needs to sort them.
+ */
+class LayeredBlocks {
+public:
+    /**
+     * @param row_max Maximum count in each row.
+     * @param nc Number of columns.
+     */
+    LayeredBlocks(const std::vector<uint32_t>& row_max, size_t nc) : nrow(row_max.size()), ncol(nc), category(nrow), position(nrow) {
+        // Assigning each row to a category based on its maximum, and then to a block within that category.
+        for (size_t r = 0; r < nrow; ++r) {
+            auto m = row_max[r];
+            uint8_t cat = (m <= 255 ? 0 : (m <= 65535 ? 1 : 2));
+            category[r] = cat;
+            position[r] = counts[cat];
+            ++counts[cat];
+        }
+
+        block_start[0] = 0;
+        for (int cat = 0; cat < 3; ++cat) {
+            block_start[cat + 1] = block_start[cat] + (counts[cat] + block_size - 1) / block_size;
+        }
+        pointers.resize(block_start[3], std::vector<size_t>(ncol + 1));
+    }
+
+    /**
+     * @return Number of blocks.
+     */
+    size_t num_blocks() const {
+        return pointers.size();
+    }
+
+    /**
+     * @param r Row index.
+     * @return Index of the block containing row `r`.
+     */
+    size_t block_of(size_t r) const {
+        return block_start[category[r]] + position[r] / block_size;
+    }
+
+    /**
+     * @param r Row index of a non-zero element.
+     * @param c Column index of a non-zero element.
+     */
+    void count(size_t r, size_t c) {
+        ++(pointers[block_of(r)][c + 1]);
+    }
+
+    /**
+     * Allocate memory for the non-zero elements in each block, after all calls to `count()`.
+     */
+    void allocate() {
+        for (auto& ptrs : pointers) {
+            for (size_t c = 0; c < ncol; ++c) {
+                ptrs[c + 1] += ptrs[c];
+            }
+        }
+
+        size_t nblocks = pointers.size();
+        indices.resize(nblocks);
+        values8.resize(block_start[1]);
+        values16.resize(block_start[2] - block_start[1]);
+        values32.resize(nblocks - block_start[2]);
+        for (size_t b = 0; b < nblocks; ++b) {
+            size_t nnz = pointers[b].back();
+            indices[b].resize(nnz);
+            if (b < block_start[1]) {
+                values8[b].resize(nnz);
+            } else if (b < block_start[2]) {
+                values16[b - block_start[1]].resize(nnz);
+            } else {
+                values32[b - block_start[2]].resize(nnz);
+            }
+        }
+
+        cursors = pointers;
+    }
+
+    /**
+     * @param r Row index of a non-zero element.
+     * @param c Column index of a non-zero element.
+     * @param v Value of the non-zero element.
+     */
+    void fill(size_t r, size_t c, uint32_t v) {
+        auto b = block_of(r);
+        auto& cur = cursors[b][c];
+        indices[b][cur] = position[r] % block_size;
+        if (b < block_start[1]) {
+            values8[b][cur] = v;
+        } else if (b < block_start[2]) {
+            values16[b - block_start[1]][cur] = v;
+        } else {
+            values32[b - block_start[2]][cur] = v;
+        }
+        ++cur;
+    }
+
+    /**
+     * Build the layered sparse matrix, after all calls to `fill()`.
+     * This object should not be used after calling this method.
+     *
+     * @return A `NumericMatrix` containing the layered sparse matrix.
+     * The row identities refer to the row indices passed to `fill()`.
+     */
+    NumericMatrix build() {
+        std::vector<std::vector<size_t> >().swap(cursors);
+
+        // Assembling the blocks in order of category, and then of position.
+        std::vector<std::shared_ptr<const tatami::Matrix<double, int> > > collected;
+        collected.reserve(pointers.size());
+        for (int cat = 0; cat < 3; ++cat) {
+            for (size_t b = block_start[cat]; b < block_start[cat + 1]; ++b) {
+                size_t nr = std::min(block_size, counts[cat] - (b - block_start[cat]) * block_size);
+                if (cat == 0) {
+                    collected.push_back(create_block(nr, pointers[b], indices[b], values8[b]));
+                } else if (cat == 1) {
+                    collected.push_back(create_block(nr, pointers[b], indices[b], values16[b - block_start[1]]));
+                } else {
+                    collected.push_back(create_block(nr, pointers[b], indices[b], values32[b - block_start[2]]));
+                }
+            }
+        }
+
+        std::vector<size_t> ids(nrow);
+        size_t offsets[3] = { 0, counts[0], counts[0] + counts[1] };
+        for (size_t r = 0; r < nrow; ++r) {
+            ids[offsets[category[r]] + position[r]] = r;
+        }
+
+        std::shared_ptr<const tatami::NumericMatrix> mat;
+        if (collected.size() == 1) {
+            mat = std::move(collected.front());
+        } else if (collected.empty()) { // no rows, so we just make an empty matrix.
+            mat.reset(new tatami::CompressedSparseMatrix<false, double, int, std::vector<uint8_t>, std::vector<uint16_t>, std::vector<size_t> >(
+                0, ncol, std::vector<uint8_t>(), std::vector<uint16_t>(), std::vector<size_t>(ncol + 1)));
+        } else {
+            mat = tatami::make_DelayedBind<0>(std::move(collected));
+        }
+
+        return NumericMatrix(std::move(mat), std::move(ids));
+    }
+
+private:
+    static constexpr size_t block_size = 65536;
+
+    size_t nrow, ncol;
+    std::vector<uint8_t> category;
+    std::vector<size_t> position;
+    size_t counts[3] = { 0, 0, 0 };
+    size_t block_start[4];
+
+    std::vector<std::vector<size_t> > pointers, cursors;
+    std::vector<std::vector<uint16_t> > indices;
+    std::vector<std::vector<uint8_t> > values8;
+    std::vector<std::vector<uint16_t> > values16;
+    std::vector<std::vector<uint32_t> > values32;
+
+    template<typename Value>
+    std::shared_ptr<const tatami::Matrix<double, int> > create_block(size_t nr, std::vector<size_t>& ptrs, std::vector<uint16_t>& idx, std::vector<Value>& vals) const {
+        // Entries in each column must be sorted by row index. This is already
+        // true if the elements were filled in order of their rows, in which
+        // case each column only needs to be checked.
+        run_parallel(ncol, [&](int first, int last) -> void {
+            std::vector<std::pair<uint16_t, Value> > buffer;
+            for (int c = first; c < last; ++c) {
+                auto start = ptrs[c], end = ptrs[c + 1];
+                if (std::is_sorted(idx.begin() + start, idx.begin() + end)) {
+                    continue;
+                }
+
+                buffer.clear();
+                for (auto i = start; i < end; ++i) {
+                    buffer.emplace_back(idx[i], vals[i]);
+                }
+                std::sort(buffer.begin(), buffer.end());
+                for (auto i = start; i < end; ++i) {
+                    idx[i] = buffer[i - start].first;
+                    vals[i] = buffer[i - start].second;
+                }
+            }
+        });
+
+        return std::shared_ptr<const tatami::Matrix<double, int> >(
+            new tatami::CompressedSparseMatrix<false, double, int, std::vector<Value>, std::vector<uint16_t>, std::vector<size_t> >(
+                nr, ncol, std::move(vals), std::move(idx), std::move(ptrs)
+            )
+        );
+    }
+};
+
+/**
+ * @brief Triplets from a coordinate matrix, to be converted into a layered sparse matrix with `LayeredBlocks`.
+ *
+ * This is useful when the maximum of each row is not known until all non-zero elements have been seen.
+ * Triplets are stored in one or more parts, so that each thread can add triplets to its own part without any locking.
+ *
+ * Within each part, triplets are grouped by ranges of 65536 rows so that each row index is stored as a 16-bit offset.
+ * Values are stored as 16-bit integers until a value in the same range exceeds 65535, after which that range switches to 32-bit integers.
+ * Each triplet usually requires 8 bytes, or 10 bytes in ranges with large values.
+ */
+class LayeredTriplets {
+public:
+    /**
+     * @brief Triplets added by a single thread.
+     */
+    struct Part {
+        /**
+         * @cond
+         */
+        struct Range {
+            std::vector<uint16_t> rows;
+            std::vector<uint32_t> cols;
+            std::vector<uint16_t> values16;
+            std::vector<uint32_t> values32;
+            bool wide = false;
+        };
+
+        std::vector<Range> ranges;
+        std::vector<uint32_t> row_max;
+
+        static constexpr size_t range_size = 65536;
+
+        template<typename T>
+        static void set_capacity(std::vector<T>& store, size_t n) {
+            if (store.capacity() < n) {
+                store.reserve(n);
+            } else if (store.capacity() > n && store.size() <= n) {
+                std::vector<T> copy;
+                copy.reserve(n);
+                copy.insert(copy.end(), store.begin(), store.end());
+                store.swap(copy);
+            }
+        }
+        /**
+         * @endcond
+         */
+
+        /**
+         * @param r Zero-based row index.
+         * @param c Zero-based column index.
+         * @param v Non-negative count.
+         */
+        void add(uint32_t r, uint32_t c, uint32_t v) {
+            auto& current = ranges[r / range_size];
+            current.rows.push_back(r % range_size);
+            current.cols.push_back(c);
+
+            if (!current.wide && v > 65535) {
+                current.values32.reserve(current.cols.capacity());
+                current.values32.insert(current.values32.end(), current.values16.begin(), current.values16.end());
+                std::vector<uint16_t>().swap(current.values16);
+                current.wide = true;
+            }
+            if (current.wide) {
+                current.values32.push_back(v);
+            } else {
+                current.values16.push_back(v);
+            }
+
+            if (row_max[r] < v) {
+                row_max[r] = v;
+            }
+        }
+
+        /**
+         * @return Number of triplets in this part.
+         */
+        size_t size() const {
+            size_t n = 0;
+            for (const auto& current : ranges) {
+                n += current.rows.size();
+            }
+            return n;
+        }
+
+        /**
+         * Set the capacity of this part, assuming that its triplets are evenly distributed across rows.
+         * Any larger reservation that has not yet been used is released.
+         *
+         * @param n Expected number of triplets in this part.
+         */
+        void preallocate(size_t n) {
+            size_t nrow = row_max.size();
+            for (size_t i = 0; i < ranges.size(); ++i) {
+                auto& current = ranges[i];
+                size_t len = std::min(range_size, nrow - i * range_size);
+                size_t expected = static_cast<double>(n) * len / nrow;
+                set_capacity(current.rows, expected);
+                set_capacity(current.cols, expected);
+                if (current.wide) {
+                    set_capacity(current.values32, expected);
+                } else {
+                    set_capacity(current.values16, expected);
+                }
+            }
+        }
+    };
+
+    /**
+     * @param nr Number of rows.
+     * @param nc Number of columns.
+     * @param reserve Expected number of non-zero elements, used to preallocate memory for the first part.
+     */
+    LayeredTriplets(size_t nr = 0, size_t nc = 0, size_t reserve = 0) : nrow(nr), ncol(nc) {
+        part(0).preallocate(reserve);
+    }
+
+    /**
+     * @param r Zero-based row index.
+     * @param c Zero-based column index.
+     * @param v Non-negative count.
+     */
+    void add(uint32_t r, uint32_t c, uint32_t v) {
+        parts.front().add(r, c, v);
+    }
+
+    /**
+     * @param i Index of the part.
+     * @return Reference to the part, which is created if it does not already exist.
+     * This should not be called concurrently unless the part was already created with `reserve_parts()`,
+     * but the returned references can be used concurrently for different parts.
+     */
+    Part& part(size_t i) {
+        while (parts.size() <= i) {
+            parts.emplace_back();
+            auto& current = parts.back();
+            current.row_max.resize(nrow);
+            current.ranges.resize((nrow + Part::range_size - 1) / Part::range_size);
+        }
+        return parts[i];
+    }
+
+    /**
+     * @param n Number of parts.
+     * @return At least `n` parts are created, so that `part()` can be called concurrently for any index less than `n`.
+     */
+    void reserve_parts(size_t n) {
+        if (n) {
+            part(n - 1);
+        }
+    }
+
+    /**
+     * @return Number of parts.
+     */
+    size_t num_parts() const {
+        return parts.size();
+    }
+
+    /**
+     * @return Number of triplets added so far.
+     */
+    size_t size() const {
+        size_t n = 0;
+        for (const auto& p : parts) {
+            n += p.size();
+        }
+        return n;
+    }
+
+    /**
+     * Build the layered sparse matrix.
+     * This object should not be used after calling this method.
+     *
+     * Each range of rows in each part is released once its triplets have been copied into the layered matrix.
+     * However, all other triplets are still held at that point, so the peak memory usage is close to the size of all triplets plus the layered matrix.
+     *
+     * @return A `NumericMatrix` containing the layered sparse matrix.
+     * The row identities refer to the row indices passed to `add()`.
+     */
+    NumericMatrix build() {
+        std::vector<uint32_t> row_max(nrow);
+        for (auto& p : parts) {
+            for (size_t r = 0; r < nrow; ++r) {
+                row_max[r] = std::max(row_max[r], p.row_max[r]);
+            }
+            std::vector<uint32_t>().swap(p.row_max);
+        }
+
+        LayeredBlocks blocks(row_max, ncol);
+        std::vector<uint32_t>().swap(row_max);
+        for (const auto& p : parts) {
+            for (size_t i = 0; i < p.ranges.size(); ++i) {
+                const auto& current = p.ranges[i];
+                size_t offset = i * Part::range_size;
+                for (size_t j = 0; j < current.rows.size(); ++j) {
+                    blocks.count(offset + current.rows[j], current.cols[j]);
+                }
+            }
+        }
+
+        blocks.allocate();
+        for (auto& p : parts) {
+            for (size_t i = 0; i < p.ranges.size(); ++i) {
+                auto& current = p.ranges[i];
+                size_t offset = i * Part::range_size;
+                for (size_t j = 0; j < current.rows.size(); ++j) {
+                    blocks.fill(offset + current.rows[j], current.cols[j], current.wide ? current.values32[j] : current.values16[j]);
+                }
+                current = Part::Range();
+            }
+        }
+        parts.clear();
+
+        return blocks.build();
+    }
+
+private:
+    size_t nrow, ncol;
+    std::vector<Part> parts;
+};
+
+#endif
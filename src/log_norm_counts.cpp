@@ -13,8 +13,11 @@ NumericMatrix log_norm_counts(const NumericMatrix& mat,
     uintptr_t size_factors,
     bool use_blocks, 
     uintptr_t blocks,
-    bool allow_zero)
+    bool allow_zero,
+    int nthreads)
 {
+    ScopedExecutionContext scope(mat.execution_context(nthreads));
+
     scran::LogNormCounts norm;
     norm.set_handle_zeros(allow_zero);
     
@@ -27,9 +30,9 @@ NumericMatrix log_norm_counts(const NumericMatrix& mat,
     }
 
     if (use_blocks) {
-        return NumericMatrix(norm.run_blocked(mat.ptr, std::move(sf), reinterpret_cast<const int32_t*>(blocks)), mat.row_ids);
+        return mat.derive(norm.run_blocked(mat.ptr, std::move(sf), reinterpret_cast<const int32_t*>(blocks)));
     } else {
-        return NumericMatrix(norm.run(mat.ptr, std::move(sf)), mat.row_ids);
+        return mat.derive(norm.run(mat.ptr, std::move(sf)));
     }
 }
 
@@ -37,7 +40,7 @@ NumericMatrix log_norm_counts(const NumericMatrix& mat,
  * @cond 
  */
 EMSCRIPTEN_BINDINGS(log_norm_counts) {
-    emscripten::function("log_norm_counts", &log_norm_counts);
+    emscripten::function("log_norm_counts", &js_bind<&log_norm_counts>::fun);
 }
 /**
  * @endcond 
@@ -0,0 +1,644 @@
+#ifndef MATRIX_MARKET_H
+#define MATRIX_MARKET_H
+
+#include "NumericMatrix.h"
+#include "layered_triplets.h"
+#include "zlib.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @file matrix_market.h
+ *
+ * @brief Incremental parsing of Matrix Market files into a layered sparse matrix.
+ *
+ * Unlike the loaders in **tatami**, the parsers here do not need the entire file to be available at once.
+ * Text can be supplied in arbitrary chunks (e.g., as they are received from a stream) and is parsed immediately,
+ * so only the parsed triplets need to be held in memory until the matrix is constructed.
+ * If the file can be read more than once, `read_matrix_market_in_passes()` avoids holding the triplets altogether.
+ */
+
+/**
+ * @brief State for parsing a complete Matrix Market file in multiple passes, see `read_matrix_market_in_passes()`.
+ */
+struct MatrixMarketPasses {
+    /**
+     * @brief Current pass over the file.
+     */
+    enum Pass { ROW_MAX, COUNT, FILL };
+
+    /**
+     * Current pass over the file.
+     */
+    Pass pass = ROW_MAX;
+
+    /**
+     * Maximum count in each row, filled in the `ROW_MAX` pass.
+     */
+    std::vector<uint32_t> row_max;
+
+    /**
+     * Number of rows and columns, from the header in the `ROW_MAX` pass.
+     */
+    size_t nrow = 0, ncol = 0;
+
+    /**
+     * Blocks of the layered matrix, created after the `ROW_MAX` pass.
+     */
+    std::unique_ptr<LayeredBlocks> blocks;
+};
+
+/**
+ * @brief Incremental parser for the text of a Matrix Market file.
+ *
+ * Only the coordinate format with non-negative integer values is supported, consistent with the **tatami** loaders.
+ * Lines may be split across calls to `add()` at any position.
+ *
+ * After the header, text is parsed in large blocks that are split at line boundaries across the threads in the current `ExecutionContext`.
+ * Each thread scans its lines for integers 8 bytes at a time and stores the triplets in its own part of a `LayeredTriplets`,
+ * so no synchronization is required until the layered matrix is built.
+ *
+ * Alternatively, the parser can perform one pass of `read_matrix_market_in_passes()`, in which case no triplets are stored.
+ * Each thread then keeps its own row maxima in the `ROW_MAX` pass, while the non-zero elements of each block of text
+ * are passed to the `LayeredBlocks` in order of their lines in the `COUNT` and `FILL` passes.
+ */
+class MatrixMarketParser {
+public:
+    /**
+     * @param p State for the current pass of `read_matrix_market_in_passes()`.
+     * If `NULL`, the parsed triplets are stored until `finish()` is called.
+     * @param bs Size of the blocks to parse in parallel, in bytes.
+     * Text is buffered until a block is filled, so this also determines the memory usage for the text.
+     */
+    MatrixMarketParser(MatrixMarketPasses* p = NULL, size_t bs = 16777216) : passes(p), block_size(bs) {}
+
+    /**
+     * Parse a chunk of text.
+     * For efficiency, large chunks containing complete lines are parsed in place, without copying into the internal buffer.
+     *
+     * @param buffer Pointer to the text.
+     * @param n Length of the text.
+     */
+    void add(const unsigned char* buffer, size_t n) {
+        if (!header_parsed) {
+            // Skipping comments until we find the line with the dimensions.
+            auto end = buffer + n;
+            while (!header_parsed) {
+                auto nl = std::find(buffer, end, '\n');
+                pending.insert(pending.end(), buffer, nl);
+                if (nl == end) {
+                    return;
+                }
+                parse_header_line();
+                buffer = nl + 1;
+            }
+            n = end - buffer;
+        }
+
+        if (!pending.empty()) {
+            if (pending.size() + n < block_size) {
+                pending.insert(pending.end(), buffer, buffer + n);
+                return;
+            }
+
+            // Completing the partial line in the buffer before parsing it.
+            auto end = buffer + n;
+            auto nl = std::find(buffer, end, '\n');
+            if (nl == end) {
+                pending.insert(pending.end(), buffer, end);
+                return;
+            }
+
+            ++nl;
+            pending.insert(pending.end(), buffer, nl);
+            parse_block(pending.data(), pending.size());
+            pending.clear();
+            n -= nl - buffer;
+            buffer = nl;
+        }
+
+        size_t complete = n;
+        while (complete > 0 && buffer[complete - 1] != '\n') {
+            --complete;
+        }
+
+        if (complete >= block_size) {
+            parse_block(buffer, complete);
+            pending.insert(pending.end(), buffer + complete, buffer + n);
+        } else {
+            pending.insert(pending.end(), buffer, buffer + n);
+        }
+    }
+
+    /**
+     * Finish parsing the text, after which no more text can be added.
+     * For a pass of `read_matrix_market_in_passes()`, this also stores the row maxima in the `ROW_MAX` pass.
+     */
+    void complete() {
+        if (!header_parsed) {
+            parse_header_line(); // in case the header didn't have a newline.
+            if (!header_parsed) {
+                throw std::runtime_error("no header line in the Matrix Market file");
+            }
+        }
+
+        parse_block(pending.data(), pending.size());
+        std::vector<unsigned char>().swap(pending);
+
+        if (observed != nlines) {
+            throw std::runtime_error("number of lines in the Matrix Market file (" + std::to_string(observed) +
+                ") is not consistent with the header (" + std::to_string(nlines) + ")");
+        }
+
+        if (passes && passes->pass == MatrixMarketPasses::ROW_MAX) {
+            for (const auto& current : segment_max) {
+                for (size_t r = 0; r < nrow; ++r) {
+                    passes->row_max[r] = std::max(passes->row_max[r], current[r]);
+                }
+            }
+            segment_max.clear();
+        }
+    }
+
+    /**
+     * Finish parsing and build the matrix from the stored triplets.
+     * This object should not be used after calling this method.
+     *
+     * @return A `NumericMatrix` containing a layered sparse matrix.
+     */
+    NumericMatrix finish() {
+        complete();
+        return build();
+    }
+
+    /**
+     * Build the matrix from the stored triplets, after calling `complete()`.
+     * This object should not be used after calling this method.
+     *
+     * @return A `NumericMatrix` containing a layered sparse matrix.
+     */
+    NumericMatrix build() {
+        return triplets.build();
+    }
+
+private:
+    MatrixMarketPasses* passes;
+    size_t block_size;
+    std::vector<unsigned char> pending;
+
+    bool header_parsed = false;
+    uint64_t nrow = 0, ncol = 0, nlines = 0;
+    size_t observed = 0;
+    LayeredTriplets triplets;
+
+    // Workspaces for each thread when parsing in passes.
+    struct Element {
+        uint32_t row, col, value;
+    };
+    std::vector<std::vector<uint32_t> > segment_max;
+    std::vector<std::vector<Element> > segment_elements;
+
+    void parse_header_line() {
+        // The pending buffer should contain a single line without the newline.
+        const unsigned char* start = pending.data();
+        const unsigned char* end = start + pending.size();
+        auto ptr = skip_spaces(start, end);
+
+        if (ptr != end && *ptr != '%') {
+            uint64_t fields[3];
+            parse_fields(ptr, end, end, fields);
+            nrow = fields[0];
+            ncol = fields[1];
+            nlines = fields[2];
+            if (nrow > UINT32_MAX || ncol > UINT32_MAX) {
+                throw std::runtime_error("dimensions of the Matrix Market file are too large");
+            }
+
+            if (!passes) {
+                triplets = LayeredTriplets(nrow, ncol);
+            } else if (passes->pass == MatrixMarketPasses::ROW_MAX) {
+                passes->row_max.resize(nrow);
+                passes->nrow = nrow;
+                passes->ncol = ncol;
+            } else if (passes->nrow != nrow || passes->ncol != ncol) {
+                throw std::runtime_error("dimensions of the Matrix Market file changed between passes");
+            }
+            header_parsed = true;
+        }
+
+        pending.clear();
+    }
+
+    void parse_block(const unsigned char* buffer, size_t n) {
+        if (n == 0) {
+            return;
+        }
+
+        // Splitting the block at line boundaries. Small blocks are not worth
+        // the overhead of parallelization, so we just use a single thread.
+        size_t nsegments = current_num_threads();
+        nsegments = std::max(static_cast<size_t>(1), std::min(nsegments, n / 65536));
+
+        std::vector<size_t> boundaries(nsegments + 1);
+        boundaries[nsegments] = n;
+        for (size_t s = 1; s < nsegments; ++s) {
+            size_t pos = std::max(boundaries[s - 1], (n / nsegments) * s);
+            auto nl = std::find(buffer + pos, buffer + n, '\n');
+            boundaries[s] = std::min(n, static_cast<size_t>(nl - buffer) + 1);
+        }
+
+        auto buffer_end = buffer + n;
+        std::vector<size_t> parsed(nsegments);
+        if (passes) {
+            parse_block_in_pass(buffer, buffer_end, boundaries, parsed);
+        } else {
+            // Using the number of lines in the header to preallocate each part,
+            // assuming that the lines are evenly distributed across parts. The
+            // first part may already hold a reservation for all lines from an
+            // earlier single-threaded block, in which case it is cut back to its share.
+            triplets.reserve_parts(nsegments);
+            size_t nparts = triplets.num_parts();
+            size_t expected = (nparts == 1 ? nlines : std::min(nlines, static_cast<uint64_t>(nlines / nparts * 1.05)));
+            for (size_t s = 0; s < nsegments; ++s) {
+                triplets.part(s).preallocate(expected);
+            }
+
+            run_parallel(nsegments, [&](int first, int last) -> void {
+                for (int s = first; s < last; ++s) {
+                    auto& output = triplets.part(s);
+                    parsed[s] = parse_lines(buffer + boundaries[s], buffer + boundaries[s + 1], buffer_end, [&](uint32_t r, uint32_t c, uint32_t v) -> void {
+                        output.add(r, c, v);
+                    });
+                }
+            }, 1);
+        }
+
+        for (auto p : parsed) {
+            observed += p;
+        }
+    }
+
+    void parse_block_in_pass(const unsigned char* buffer, const unsigned char* buffer_end, const std::vector<size_t>& boundaries, std::vector<size_t>& parsed) {
+        size_t nsegments = parsed.size();
+
+        if (passes->pass == MatrixMarketPasses::ROW_MAX) {
+            // Each thread keeps its own maxima, which are combined in complete().
+            if (segment_max.size() < nsegments) {
+                segment_max.resize(nsegments, std::vector<uint32_t>(nrow));
+            }
+            run_parallel(nsegments, [&](int first, int last) -> void {
+                for (int s = first; s < last; ++s) {
+                    auto& current = segment_max[s];
+                    parsed[s] = parse_lines(buffer + boundaries[s], buffer + boundaries[s + 1], buffer_end, [&](uint32_t r, uint32_t, uint32_t v) -> void {
+                        current[r] = std::max(current[r], v);
+                    });
+                }
+            }, 1);
+            return;
+        }
+
+        // Elements in different segments may share a block and column, so
+        // they are only parsed in parallel and then passed to the blocks in
+        // order of their lines. This also preserves the order of the rows.
+        segment_elements.resize(nsegments);
+        run_parallel(nsegments, [&](int first, int last) -> void {
+            for (int s = first; s < last; ++s) {
+                auto& current = segment_elements[s];
+                current.clear();
+                parsed[s] = parse_lines(buffer + boundaries[s], buffer + boundaries[s + 1], buffer_end, [&](uint32_t r, uint32_t c, uint32_t v) -> void {
+                    current.push_back(Element{ r, c, v });
+                });
+            }
+        }, 1);
+
+        auto& blocks = *(passes->blocks);
+        for (const auto& current : segment_elements) {
+            if (passes->pass == MatrixMarketPasses::COUNT) {
+                for (const auto& x : current) {
+                    blocks.count(x.row, x.col);
+                }
+            } else {
+                for (const auto& x : current) {
+                    blocks.fill(x.row, x.col, x.value);
+                }
+            }
+        }
+    }
+
+    static const unsigned char* skip_spaces(const unsigned char* ptr, const unsigned char* end) {
+        while (ptr < end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r')) {
+            ++ptr;
+        }
+        return ptr;
+    }
+
+    static std::runtime_error invalid_line(const unsigned char* start, const unsigned char* end) {
+        std::string line(start, std::find(start, end, '\n'));
+        if (line.size() > 50) {
+            line = line.substr(0, 50) + "...";
+        }
+        return std::runtime_error("invalid line '" + line + "' in the Matrix Market file, expected three non-negative integers");
+    }
+
+    /*
+     * Scanning digits 8 bytes at a time. We check whether each byte is a
+     * digit by looking at its high nibble (which should be 3) and the carry
+     * from adding 6 to the low nibble (which should not spill into the high
+     * nibble). Any carry out of a non-digit byte only affects later bytes,
+     * which are ignored anyway. The leading digits are then converted with the
+     * usual multiply-and-shift tricks for combining adjacent digits.
+     */
+    static int count_leading_digits(uint64_t v) {
+        uint64_t high = (v & 0xF0F0F0F0F0F0F0F0ull) ^ 0x3030303030303030ull;
+        uint64_t low = ((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) ^ 0x3030303030303030ull;
+        uint64_t nondigit = high | low;
+        uint64_t mask = (((nondigit & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full) | nondigit) & 0x8080808080808080ull;
+        return (mask ? __builtin_ctzll(mask) / 8 : 8);
+    }
+
+    static uint64_t convert_digits(uint64_t v, int ndigits) {
+        v &= 0x0F0F0F0F0F0F0F0Full;
+        v <<= 8 * (8 - ndigits); // first digit is in the lowest byte, so this pads with leading zeros.
+        v = (v * 2561) >> 8;
+        v = ((v & 0x00FF00FF00FF00FFull) * 6553601) >> 16;
+        return ((v & 0x0000FFFF0000FFFFull) * 42949672960001ull) >> 32;
+    }
+
+    // Reads up to 'limit' are safe, but digits must stop at or before 'end'.
+    // This allows us to use the fast path for numbers at the end of a line.
+    static const unsigned char* parse_integer(const unsigned char* ptr, const unsigned char* end, const unsigned char* limit, uint64_t& value) {
+        value = 0;
+
+        while (limit - ptr >= 8) {
+            uint64_t v;
+            std::memcpy(&v, ptr, 8);
+            int ndigits = count_leading_digits(v);
+            if (ndigits == 0) {
+                break;
+            }
+
+            if (value > (UINT64_MAX / 100000000)) {
+                throw std::runtime_error("integer is too large in the Matrix Market file");
+            }
+            static constexpr uint64_t powers[9] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+            value = value * powers[ndigits] + convert_digits(v, ndigits);
+            ptr += ndigits;
+            if (ndigits < 8) {
+                return ptr;
+            }
+        }
+
+        // Falling back to byte-by-byte scanning near the end of the buffer.
+        while (ptr < end && *ptr >= '0' && *ptr <= '9') {
+            if (value > (UINT64_MAX / 10)) {
+                throw std::runtime_error("integer is too large in the Matrix Market file");
+            }
+            value = value * 10 + (*ptr - '0');
+            ++ptr;
+        }
+
+        return ptr;
+    }
+
+    static void parse_fields(const unsigned char* ptr, const unsigned char* end, const unsigned char* limit, uint64_t* fields) {
+        auto start = ptr;
+        for (int f = 0; f < 3; ++f) {
+            if (f) {
+                auto next = skip_spaces(ptr, end);
+                if (next == ptr) {
+                    throw invalid_line(start, end);
+                }
+                ptr = next;
+            }
+            auto next = parse_integer(ptr, end, limit, fields[f]);
+            if (next == ptr) {
+                throw invalid_line(start, end);
+            }
+            ptr = next;
+        }
+
+        ptr = skip_spaces(ptr, end);
+        if (ptr != end) {
+            throw invalid_line(start, end);
+        }
+    }
+
+    template<class Add>
+    size_t parse_lines(const unsigned char* ptr, const unsigned char* end, const unsigned char* limit, Add add) const {
+        uint64_t fields[3];
+        size_t parsed = 0;
+        while (ptr < end) {
+            auto nl = std::find(ptr, end, '\n');
+            auto current = skip_spaces(ptr, nl);
+
+            if (current != nl && *current != '%') {
+                parse_fields(current, nl, limit, fields);
+                if (fields[0] < 1 || fields[0] > nrow) {
+                    throw std::runtime_error("row index out of range in the Matrix Market file");
+                }
+                if (fields[1] < 1 || fields[1] > ncol) {
+                    throw std::runtime_error("column index out of range in the Matrix Market file");
+                }
+                if (fields[2] > UINT32_MAX) {
+                    throw std::runtime_error("value is too large in the Matrix Market file");
+                }
+                add(fields[0] - 1, fields[1] - 1, fields[2]);
+                ++parsed;
+            }
+
+            ptr = nl + (nl != end);
+        }
+
+        return parsed;
+    }
+};
+
+/**
+ * @brief Incremental decompression and parsing of a (possibly Gzip-compressed) Matrix Market file.
+ *
+ * Chunks of the file are supplied with `add()`, which inflates them (if necessary) into a fixed-size buffer for parsing.
+ * The peak memory usage is thus determined by the parsed triplets and the size of each chunk, not the size of the file.
+ */
+class MatrixMarketStream {
+public:
+    /**
+     * @param c Whether the file is Gzip-compressed.
+     * This may be 1 (yes), 0 (no), or -1, in which case it is determined from the magic number at the start of the file.
+     * @param passes State for the current pass of `read_matrix_market_in_passes()`, see `MatrixMarketParser`.
+     */
+    MatrixMarketStream(int c = -1, MatrixMarketPasses* passes = NULL) : compressed(c), parser(passes) {}
+
+    ~MatrixMarketStream() {
+        if (inflating) {
+            inflateEnd(&strm);
+        }
+    }
+
+    MatrixMarketStream(const MatrixMarketStream&) = delete;
+    MatrixMarketStream& operator=(const MatrixMarketStream&) = delete;
+
+    /**
+     * @param buffer Pointer to a chunk of the file.
+     * @param n Length of the chunk.
+     */
+    void add(const unsigned char* buffer, size_t n) {
+        if (n == 0) {
+            return;
+        }
+
+        if (compressed < 0) {
+            // Holding onto the first byte in case the magic number is split across chunks.
+            size_t take = std::min(n, 2 - pending.size());
+            pending.insert(pending.end(), buffer, buffer + take);
+            if (pending.size() < 2) {
+                return;
+            }
+
+            compressed = (pending[0] == 0x1f && pending[1] == 0x8b);
+            auto previous = std::move(pending);
+            process(previous.data(), previous.size());
+            process(buffer + take, n - take);
+            return;
+        }
+
+        process(buffer, n);
+    }
+
+    /**
+     * Finish parsing the file, after which no more chunks can be added.
+     */
+    void complete() {
+        if (compressed < 0) { // file is too short to have a magic number, so it can't be compressed.
+            compressed = 0;
+            process(pending.data(), pending.size());
+        }
+        if (compressed && inflating && !stream_ended) {
+            throw std::runtime_error("incomplete Gzip stream for the Matrix Market file");
+        }
+        parser.complete();
+    }
+
+    /**
+     * Finish parsing and build the matrix from the stored triplets.
+     * This object should not be used after calling this method.
+     *
+     * @return A `NumericMatrix` containing a layered sparse matrix.
+     */
+    NumericMatrix finish() {
+        complete();
+        return parser.build();
+    }
+
+private:
+    int compressed;
+    std::vector<unsigned char> pending;
+    MatrixMarketParser parser;
+
+    z_stream strm;
+    bool inflating = false;
+    bool stream_ended = false;
+    std::vector<unsigned char> output;
+
+    void process(const unsigned char* buffer, size_t n) {
+        if (n == 0) {
+            return;
+        }
+        if (!compressed) {
+            parser.add(buffer, n);
+            return;
+        }
+
+        if (!inflating) {
+            strm.zalloc = Z_NULL;
+            strm.zfree = Z_NULL;
+            strm.opaque = Z_NULL;
+            strm.avail_in = 0;
+            strm.next_in = Z_NULL;
+            if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) {
+                throw std::runtime_error("failed to initialize Gzip decompression");
+            }
+            inflating = true;
+            output.resize(65536);
+        }
+
+        strm.next_in = const_cast<unsigned char*>(buffer);
+        strm.avail_in = n;
+
+        while (strm.avail_in) {
+            if (stream_ended) { // handling concatenated Gzip members.
+                inflateReset(&strm);
+                stream_ended = false;
+            }
+
+            strm.next_out = output.data();
+            strm.avail_out = output.size();
+            int ret = inflate(&strm, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                throw std::runtime_error("failed to decompress the Matrix Market file" + (strm.msg ? ": " + std::string(strm.msg) : std::string()));
+            }
+
+            parser.add(output.data(), output.size() - strm.avail_out);
+            if (ret == Z_STREAM_END) {
+                stream_ended = true;
+            }
+        }
+
+        // Flushing any remaining output that didn't fit in the buffer.
+        while (!stream_ended) {
+            strm.next_out = output.data();
+            strm.avail_out = output.size();
+            int ret = inflate(&strm, Z_NO_FLUSH);
+            size_t produced = output.size() - strm.avail_out;
+            if (produced == 0) {
+                break;
+            }
+            parser.add(output.data(), produced);
+            if (ret == Z_STREAM_END) {
+                stream_ended = true;
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                throw std::runtime_error("failed to decompress the Matrix Market file");
+            }
+        }
+    }
+};
+
+/**
+ * Parse a complete Matrix Market file in three passes, without storing the triplets.
+ * The first pass computes the maximum of each row, the second counts the non-zero elements in each block and column of a `LayeredBlocks`,
+ * and the third fills those blocks.
+ * The peak memory usage is thus the layered matrix plus one block of text, compared to the triplets plus the layered matrix for `MatrixMarketStream::finish()`.
+ *
+ * @tparam Feed Function that accepts a `MatrixMarketStream&` and passes the entire file to its `add()` method.
+ *
+ * @param compressed Whether the file is Gzip-compressed, see `MatrixMarketStream`.
+ * @param feed Function to supply the file to each pass.
+ * This is called once per pass, so the file should be available for multiple reads.
+ *
+ * @return A `NumericMatrix` containing a layered sparse matrix.
+ */
+template<class Feed>
+NumericMatrix read_matrix_market_in_passes(int compressed, Feed feed) {
+    MatrixMarketPasses passes;
+    for (auto p : { MatrixMarketPasses::ROW_MAX, MatrixMarketPasses::COUNT, MatrixMarketPasses::FILL }) {
+        passes.pass = p;
+        MatrixMarketStream stream(compressed, &passes);
+        feed(stream);
+        stream.complete();
+
+        if (p == MatrixMarketPasses::ROW_MAX) {
+            passes.blocks.reset(new LayeredBlocks(passes.row_max, passes.ncol));
+            std::vector<uint32_t>().swap(passes.row_max);
+        } else if (p == MatrixMarketPasses::COUNT) {
+            passes.blocks->allocate();
+        }
+    }
+    return passes.blocks->build();
+}
+
+#endif
@@ -22,10 +22,14 @@
  * Larger values result in stronger shrinkage when the coverage is low.
  * @param[out] output Offset to a double-precision array of length equal to the number of cells in `mat`,
  * to store the size factor for each cell.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
  * 
  * @return `output` is filled with the size factors for all cells in `mat`.
  */
-void median_size_factors(const NumericMatrix& mat, bool use_ref, uintptr_t ref, bool center, double prior_count, uintptr_t output) {
+void median_size_factors(const NumericMatrix& mat, bool use_ref, uintptr_t ref, bool center, double prior_count, uintptr_t output, int nthreads) {
+    ScopedExecutionContext scope(mat.execution_context(nthreads));
+
     scran::MedianSizeFactors med;
     med.set_center(center).set_prior_count(prior_count);
     auto optr = reinterpret_cast<double*>(output);
@@ -44,7 +48,7 @@ void median_size_factors(const NumericMatrix& mat, bool use_ref, uintptr_t ref,
  * @cond
  */
 EMSCRIPTEN_BINDINGS(median_size_factors) {
-    emscripten::function("median_size_factors", &median_size_factors);
+    emscripten::function("median_size_factors", &js_bind<&median_size_factors>::fun);
 }
 /**
  * @endcond
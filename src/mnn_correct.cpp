@@ -1,6 +1,7 @@
 #include <emscripten/bind.h>
 #include "parallel.h"
 #include "mnncorrect/MnnCorrect.hpp"
+#include "utils.h"
 #include <vector>
 #include <cstdint>
 
@@ -15,8 +16,11 @@ void mnn_correct(
     int riters, 
     double rtrim,
     std::string ref_policy, 
-    bool approximate)
+    bool approximate,
+    int nthreads)
 {
+    ScopedExecutionContext scope{ ExecutionContext(nthreads) };
+
     auto bptr = reinterpret_cast<const int32_t*>(batch);
     auto iptr = reinterpret_cast<const double*>(input);
     auto optr = reinterpret_cast<double*>(output);
@@ -45,7 +49,7 @@ void mnn_correct(
  * @cond
  */
 EMSCRIPTEN_BINDINGS(mnn_correct) {
-    emscripten::function("mnn_correct", &mnn_correct);
+    emscripten::function("mnn_correct", &js_bind<&mnn_correct>::fun);
 }
 /**
  * @endcond
@@ -124,10 +124,14 @@ struct ModelGeneVar_Results {
  * Block IDs should be consecutive and 0-based.
  * If `use_blocks = false`, this value is ignored.
  * @param span The span of the LOWESS smoother for fitting the mean-variance trend.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
  *
  * @return A `ModelGeneVar_Results` object containing the variance modelling statistics.
  */
-ModelGeneVar_Results model_gene_var(const NumericMatrix& mat, bool use_blocks, uintptr_t blocks, double span) {
+ModelGeneVar_Results model_gene_var(const NumericMatrix& mat, bool use_blocks, uintptr_t blocks, double span, int nthreads) {
+    ScopedExecutionContext scope(mat.execution_context(nthreads));
+
     const int32_t* bptr = NULL;
     if (use_blocks) {
         bptr = reinterpret_cast<const int32_t*>(blocks);
@@ -143,14 +147,14 @@ ModelGeneVar_Results model_gene_var(const NumericMatrix& mat, bool use_blocks, u
  * @cond 
  */
 EMSCRIPTEN_BINDINGS(model_gene_var) {
-    emscripten::function("model_gene_var", &model_gene_var);
+    emscripten::function("model_gene_var", &js_bind<&model_gene_var>::fun);
 
     emscripten::class_<ModelGeneVar_Results>("ModelGeneVar_Results")
-        .function("means", &ModelGeneVar_Results::means)
-        .function("variances", &ModelGeneVar_Results::variances)
-        .function("fitted", &ModelGeneVar_Results::fitted)
-        .function("residuals", &ModelGeneVar_Results::residuals)
-        .function("num_blocks", &ModelGeneVar_Results::num_blocks)
+        .function("means", &js_bind<&ModelGeneVar_Results::means>::fun)
+        .function("variances", &js_bind<&ModelGeneVar_Results::variances>::fun)
+        .function("fitted", &js_bind<&ModelGeneVar_Results::fitted>::fun)
+        .function("residuals", &js_bind<&ModelGeneVar_Results::residuals>::fun)
+        .function("num_blocks", &js_bind<&ModelGeneVar_Results::num_blocks>::fun)
         ;
 }
 /**
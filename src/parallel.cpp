@@ -1,8 +1,123 @@
 #include "parallel.h"
 #include "emscripten.h"
 
-bool enable_parallel = true;
-
+// Using the configured number of threads rather than the number of idle
+// workers, so that the size of the pool does not depend on what else happens
+// to be running when the pool is first created.
 EM_JS(int, find_num_threads, (), {
+    if ("scran_custom_nthreads" in Module) {
+        return Math.max(Module.scran_custom_nthreads, 1);
+    }
     return Math.max(PThread.unusedWorkers.length, 1);
 });
+
+static thread_local bool inside_job = false;
+
+ThreadPool::ThreadPool(int n) {
+    workers.reserve(n);
+    for (int w = 0; w < n; ++w) {
+        workers.emplace_back([this]() -> void {
+            std::unique_lock<std::mutex> lck(lock);
+            while (true) {
+                available.wait(lck, [this]() -> bool { return stopping || !queue.empty(); });
+                if (queue.empty()) { // only possible if we're stopping.
+                    return;
+                }
+
+                auto job = queue.front();
+                queue.pop_front();
+                lck.unlock();
+                execute(job);
+                lck.lock();
+            }
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lck(lock);
+        stopping = true;
+    }
+    available.notify_all();
+    for (auto& wrk : workers) {
+        wrk.join();
+    }
+}
+
+void ThreadPool::execute(Job& job) {
+    std::exception_ptr err;
+    bool was_inside = inside_job;
+    inside_job = true;
+    try {
+        (*job.fun)();
+    } catch (...) {
+        err = std::current_exception();
+    }
+    inside_job = was_inside;
+
+    bool done;
+    {
+        std::lock_guard<std::mutex> lck(lock);
+        auto& batch = *(job.batch);
+        if (err && !batch.error) {
+            batch.error = err;
+        }
+        --batch.remaining;
+        done = (batch.remaining == 0);
+    }
+
+    if (done) {
+        finished.notify_all();
+    }
+}
+
+void ThreadPool::run(std::vector<std::function<void()> >& jobs) {
+    if (jobs.empty()) {
+        return;
+    }
+
+    Batch batch;
+    batch.remaining = jobs.size();
+
+    if (jobs.size() > 1) {
+        {
+            std::lock_guard<std::mutex> lck(lock);
+            for (size_t j = 1; j < jobs.size(); ++j) {
+                queue.emplace_back(&(jobs[j]), &batch);
+            }
+        }
+        available.notify_all();
+    }
+
+    Job mine(&(jobs.front()), &batch);
+    execute(mine);
+
+    // Helping out with anything left in the queue while we wait; this may
+    // include jobs from other callers, which is fine as they'll be notified.
+    std::unique_lock<std::mutex> lck(lock);
+    while (batch.remaining) {
+        if (!queue.empty()) {
+            auto job = queue.front();
+            queue.pop_front();
+            lck.unlock();
+            execute(job);
+            lck.lock();
+        } else {
+            finished.wait(lck);
+        }
+    }
+
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+}
+
+ThreadPool& ThreadPool::global() {
+    static ThreadPool pool(find_num_threads() - 1);
+    return pool;
+}
+
+bool ThreadPool::in_job() {
+    return inside_job;
+}
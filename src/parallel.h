@@ -1,45 +1,339 @@
 #ifndef PARALLEL_H
 #define PARALLEL_H
 
+/**
+ * @brief Execution settings for parallel sections started on the current thread.
+ *
+ * Each thread has its own current context, so settings for one binding do not affect other bindings running concurrently on other threads.
+ * Contexts should be installed with `ScopedExecutionContext` rather than modified directly.
+ */
+struct ExecutionContext {
+    /**
+     * @param n Maximum number of threads, see `num_threads`.
+     * @param g Grain size, see `grain_size`.
+     * @param s Whether to serialize, see `serialize`.
+     */
+    ExecutionContext(int n = 0, int g = 0, bool s = false) : num_threads(n), grain_size(g), serialize(s) {}
+
+    /**
+     * Maximum number of threads to use in each parallel section, including the calling thread.
+     * If zero, all threads in the pool are used.
+     */
+    int num_threads;
+
+    /**
+     * Grain size for parallel sections that do not request one explicitly, see `run_parallel()`.
+     * If zero, jobs are split into equal contiguous ranges.
+     */
+    int grain_size;
+
+    /**
+     * Whether the work is I/O-bound and should be run entirely on the calling thread,
+     * e.g., because the underlying library (looking at you, HDF5) is not thread-safe.
+     */
+    bool serialize;
+
+    /**
+     * @return The context for the current thread.
+     */
+    static ExecutionContext& current() {
+        static thread_local ExecutionContext ctx;
+        return ctx;
+    }
+};
+
+/**
+ * @brief Install an `ExecutionContext` for the lifetime of this object.
+ *
+ * The previous context for the current thread is restored on destruction, even if an exception is thrown.
+ */
+class ScopedExecutionContext {
+public:
+    /**
+     * @param ctx Context to use on the current thread.
+     */
+    ScopedExecutionContext(ExecutionContext ctx) : previous(ExecutionContext::current()) {
+        ExecutionContext::current() = ctx;
+    }
+
+    ~ScopedExecutionContext() {
+        ExecutionContext::current() = previous;
+    }
+
+    ScopedExecutionContext(const ScopedExecutionContext&) = delete;
+    ScopedExecutionContext& operator=(const ScopedExecutionContext&) = delete;
+private:
+    ExecutionContext previous;
+};
+
 #ifdef __EMSCRIPTEN_PTHREADS__
 #include <thread>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <deque>
 #include <cmath>
 #include <vector>
+#include <atomic>
+#include <memory>
 
 extern "C" {
-    
+
 int find_num_threads();
 
 }
 
-extern bool enable_parallel;
+/**
+ * @brief Persistent pool of worker threads.
+ *
+ * Under Emscripten, each new `std::thread` involves a round-trip to a Web Worker, which is expensive relative to short parallel sections.
+ * Instead, we spin up the workers once and feed them jobs through a shared queue.
+ * All bindings share the same pool via `ThreadPool::global()`.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param n Number of worker threads.
+     * This may be zero, in which case all jobs are executed on the calling thread.
+     */
+    ThreadPool(int n);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @return Number of worker threads in the pool.
+     * This does not include the calling thread, which also participates in `run()`.
+     */
+    int size() const {
+        return workers.size();
+    }
+
+    /**
+     * Execute all jobs, blocking until they are complete.
+     * The first job is executed on the calling thread while the others are queued for the workers.
+     * The calling thread will also pick up queued jobs while it waits.
+     *
+     * @param jobs Jobs to execute.
+     *
+     * If any job throws, the first exception is rethrown on the calling thread once all jobs have finished.
+     */
+    void run(std::vector<std::function<void()> >& jobs);
+
+    /**
+     * @param requested Requested number of threads, see `ExecutionContext::num_threads`.
+     * @return Number of threads to use, including the calling thread.
+     */
+    int num_threads(int requested) const {
+        int available = size() + 1;
+        return (requested > 0 && requested < available ? requested : available);
+    }
+
+    /**
+     * @return The pool shared by all bindings.
+     * This is created on first use with one fewer worker than the number of available threads, as the calling thread also does work.
+     */
+    static ThreadPool& global();
+
+    /**
+     * @return Whether the current thread is executing a job from any pool.
+     * Nested calls to `run_parallel()` from inside a job are executed serially to avoid deadlocks and oversubscription.
+     */
+    static bool in_job();
+
+private:
+    struct Batch {
+        int remaining = 0;
+        std::exception_ptr error;
+    };
+
+    struct Job {
+        Job(std::function<void()>* f, Batch* b) : fun(f), batch(b) {}
+        std::function<void()>* fun;
+        Batch* batch;
+    };
 
+    void execute(Job&);
+
+    std::vector<std::thread> workers;
+    std::deque<Job> queue;
+    std::mutex lock;
+    std::condition_variable available, finished;
+    bool stopping = false;
+};
+
+/**
+ * Run a function across the workers in the global pool.
+ * The number of threads is determined by the current `ExecutionContext`.
+ *
+ * @param total Total number of jobs.
+ * @param fun Function that accepts the start and one-past-the-end of a range of jobs.
+ * This may be called multiple times on the same thread for different ranges.
+ * @param grain Grain size.
+ * If zero, the jobs are split into equal contiguous ranges, one per thread, and `fun` is called once per range.
+ * If positive, the jobs are split into chunks of size `grain`.
+ * Each thread starts on its own contiguous block of chunks and then steals the remaining chunks from other threads once its own block is exhausted.
+ * This avoids stragglers when the cost of each job varies greatly, at the cost of more calls to `fun`.
+ */
+template<class Function>
+void run_parallel(int total, Function fun, int grain) {
+    const auto& ctx = ExecutionContext::current();
+    if (ctx.serialize || ctx.num_threads == 1 || ThreadPool::in_job()) {
+        fun(0, total);
+        return;
+    }
+
+    auto& pool = ThreadPool::global();
+    int nworkers = pool.num_threads(ctx.num_threads);
+    std::vector<std::function<void()> > jobs;
+    jobs.reserve(nworkers);
+
+    if (grain <= 0) {
+        int jobs_per_worker = std::ceil(static_cast<double>(total)/nworkers);
+        int first = 0;
+        for (int w = 0; w < nworkers && first < total; ++w, first += jobs_per_worker) {
+            int last = std::min(first + jobs_per_worker, total);
+            jobs.emplace_back([&fun,first,last]() -> void { fun(first, last); });
+        }
+        pool.run(jobs);
+        return;
+    }
+
+    if (total <= 0) {
+        return;
+    }
+
+    int nchunks = std::ceil(static_cast<double>(total)/grain);
+    nworkers = std::min(nworkers, nchunks);
+    int chunks_per_worker = std::ceil(static_cast<double>(nchunks)/nworkers);
+
+    // Each worker owns the chunks in [next[w], limit[w]). Chunks are claimed
+    // with an atomic increment, so each chunk is processed exactly once
+    // regardless of whether it is claimed by its owner or a thief.
+    std::unique_ptr<std::atomic<int>[]> next(new std::atomic<int>[nworkers]);
+    std::vector<int> limit(nworkers);
+    for (int w = 0; w < nworkers; ++w) {
+        next[w] = std::min(w * chunks_per_worker, nchunks);
+        limit[w] = std::min(next[w] + chunks_per_worker, nchunks);
+    }
+
+    for (int w = 0; w < nworkers; ++w) {
+        jobs.emplace_back([&,w]() -> void {
+            for (int offset = 0; offset < nworkers; ++offset) {
+                int victim = (w + offset) % nworkers;
+                while (true) {
+                    int c = next[victim].fetch_add(1);
+                    if (c >= limit[victim]) {
+                        break;
+                    }
+                    int first = c * grain;
+                    fun(first, std::min(first + grain, total));
+                }
+            }
+        });
+    }
+
+    pool.run(jobs);
+}
+
+/**
+ * Overload of `run_parallel()` that uses the grain size in the current `ExecutionContext`.
+ * This is the form used by **tatami**, **libscran** and friends.
+ *
+ * @param total Total number of jobs.
+ * @param fun Function that accepts the start and one-past-the-end of a range of jobs.
+ */
 template<class Function>
 void run_parallel(int total, Function fun) {
-    if (!enable_parallel) {
+    run_parallel(total, std::move(fun), ExecutionContext::current().grain_size);
+}
+
+/**
+ * Run I/O on the calling thread while other jobs are executed by the workers in the global pool.
+ * This allows reads from libraries that are not thread-safe (looking at you again, HDF5) to overlap with computation on the results of previous reads.
+ * The number of threads is determined by the current `ExecutionContext`.
+ *
+ * @param io Function that performs the I/O.
+ * This is called exactly once on the calling thread, which then helps with the other jobs.
+ * @param total Total number of jobs.
+ * @param fun Function that accepts the start and one-past-the-end of a range of jobs.
+ * This should not depend on anything done by `io`.
+ * @param grain Grain size, i.e., the number of jobs in each range passed to `fun`.
+ */
+template<class Io, class Function>
+void run_parallel_with_io(Io io, int total, Function fun, int grain = 1) {
+    const auto& ctx = ExecutionContext::current();
+    if (ctx.serialize || ctx.num_threads == 1 || ThreadPool::in_job()) {
+        io();
         fun(0, total);
         return;
     }
 
-    int nworkers = find_num_threads();
-    int jobs_per_worker = std::ceil(static_cast<double>(total)/nworkers);
-    std::vector<std::thread> workers;
-    workers.reserve(nworkers);
-    int first = 0;
+    auto& pool = ThreadPool::global();
+    int nworkers = pool.num_threads(ctx.num_threads);
+    grain = std::max(grain, 1);
+    int nchunks = std::ceil(static_cast<double>(total)/grain);
+
+    std::atomic<int> next(0);
+    auto work = [&]() -> void {
+        while (true) {
+            int c = next.fetch_add(1);
+            if (c >= nchunks) {
+                break;
+            }
+            int first = c * grain;
+            fun(first, std::min(first + grain, total));
+        }
+    };
 
-    for (int w = 0; w < nworkers && first < total; ++w, first += jobs_per_worker) {
-        int last = std::min(first + jobs_per_worker, total);
-        workers.emplace_back(fun, first, last);
+    std::vector<std::function<void()> > jobs;
+    jobs.reserve(nworkers);
+    jobs.emplace_back([&]() -> void { // the first job is always run on the calling thread.
+        io();
+        work();
+    });
+    for (int w = 1; w < nworkers; ++w) {
+        jobs.emplace_back(work);
     }
 
-    for (auto& wrk : workers) {
-        wrk.join();
+    pool.run(jobs);
+}
+
+/**
+ * @return Number of threads that will be used by `run_parallel()` under the current `ExecutionContext`.
+ */
+inline int current_num_threads() {
+    const auto& ctx = ExecutionContext::current();
+    if (ctx.serialize || ThreadPool::in_job()) {
+        return 1;
     }
+    return ThreadPool::global().num_threads(ctx.num_threads);
 }
 
 #define TATAMI_CUSTOM_PARALLEL run_parallel
 #define SCRAN_CUSTOM_PARALLEL run_parallel
 #define MNNCORRECT_CUSTOM_PARALLEL run_parallel
 
+#else
+
+template<class Function>
+void run_parallel(int total, Function fun, int = 0) {
+    fun(0, total);
+}
+
+template<class Io, class Function>
+void run_parallel_with_io(Io io, int total, Function fun, int = 1) {
+    io();
+    fun(0, total);
+}
+
+inline int current_num_threads() {
+    return 1;
+}
+
 #endif
 #endif
@@ -92,14 +92,14 @@ PerCellAdtQcFilters_Results per_cell_adt_qc_filters(PerCellAdtQcMetrics_Results&
 }
 
 EMSCRIPTEN_BINDINGS(per_cell_adt_qc_filters) {
-    emscripten::function("per_cell_adt_qc_filters", &per_cell_adt_qc_filters);
+    emscripten::function("per_cell_adt_qc_filters", &js_bind<&per_cell_adt_qc_filters>::fun);
 
     emscripten::class_<PerCellAdtQcFilters_Results>("PerCellAdtQcFilters_Results")
-        .function("thresholds_detected", &PerCellAdtQcFilters_Results::thresholds_detected)
-        .function("thresholds_subset_totals", &PerCellAdtQcFilters_Results::thresholds_subset_totals)
-        .function("discard_detected", &PerCellAdtQcFilters_Results::discard_detected)
-        .function("discard_subset_totals", &PerCellAdtQcFilters_Results::discard_subset_totals)
-        .function("discard_overall", &PerCellAdtQcFilters_Results::discard_overall)
-        .function("num_subsets", &PerCellAdtQcFilters_Results::num_subsets)
+        .function("thresholds_detected", &js_bind<&PerCellAdtQcFilters_Results::thresholds_detected>::fun)
+        .function("thresholds_subset_totals", &js_bind<&PerCellAdtQcFilters_Results::thresholds_subset_totals>::fun)
+        .function("discard_detected", &js_bind<&PerCellAdtQcFilters_Results::discard_detected>::fun)
+        .function("discard_subset_totals", &js_bind<&PerCellAdtQcFilters_Results::discard_subset_totals>::fun)
+        .function("discard_overall", &js_bind<&PerCellAdtQcFilters_Results::discard_overall>::fun)
+        .function("num_subsets", &js_bind<&PerCellAdtQcFilters_Results::num_subsets>::fun)
         ;
 }
@@ -10,20 +10,22 @@
 #include <cstdint>
 #include <cmath>
 
-PerCellAdtQcMetrics_Results per_cell_adt_qc_metrics(const NumericMatrix& mat, int nsubsets, uintptr_t subsets) {
+PerCellAdtQcMetrics_Results per_cell_adt_qc_metrics(const NumericMatrix& mat, int nsubsets, uintptr_t subsets, int nthreads) {
+    ScopedExecutionContext scope(mat.execution_context(nthreads));
+
     scran::PerCellAdtQcMetrics qc;
     auto store = qc.run(mat.ptr.get(), convert_array_of_offsets<const uint8_t*>(nsubsets, subsets));
     return PerCellAdtQcMetrics_Results(std::move(store));
 }
 
 EMSCRIPTEN_BINDINGS(per_cell_qc_metrics) {
-    emscripten::function("per_cell_adt_qc_metrics", &per_cell_adt_qc_metrics);
+    emscripten::function("per_cell_adt_qc_metrics", &js_bind<&per_cell_adt_qc_metrics>::fun);
 
     emscripten::class_<PerCellAdtQcMetrics_Results>("PerCellAdtQcMetrics_Results")
-        .constructor<int, int>()
-        .function("sums", &PerCellAdtQcMetrics_Results::sums)
-        .function("detected", &PerCellAdtQcMetrics_Results::detected)
-        .function("subset_totals", &PerCellAdtQcMetrics_Results::subset_totals)
-        .function("num_subsets", &PerCellAdtQcMetrics_Results::num_subsets)
+        .constructor(&js_construct<PerCellAdtQcMetrics_Results, int, int>, emscripten::allow_raw_pointers())
+        .function("sums", &js_bind<&PerCellAdtQcMetrics_Results::sums>::fun)
+        .function("detected", &js_bind<&PerCellAdtQcMetrics_Results::detected>::fun)
+        .function("subset_totals", &js_bind<&PerCellAdtQcMetrics_Results::subset_totals>::fun)
+        .function("num_subsets", &js_bind<&PerCellAdtQcMetrics_Results::num_subsets>::fun)
         ;
 }
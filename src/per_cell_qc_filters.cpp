@@ -121,17 +121,17 @@ PerCellQCFilters_Results per_cell_qc_filters(PerCellQCMetrics_Results& metrics,
  * @cond 
  */
 EMSCRIPTEN_BINDINGS(per_cell_qc_filters) {
-    emscripten::function("per_cell_qc_filters", &per_cell_qc_filters);
+    emscripten::function("per_cell_qc_filters", &js_bind<&per_cell_qc_filters>::fun);
 
     emscripten::class_<PerCellQCFilters_Results>("PerCellQCFilters_Results")
-        .function("thresholds_sums", &PerCellQCFilters_Results::thresholds_sums)
-        .function("thresholds_detected", &PerCellQCFilters_Results::thresholds_detected)
-        .function("thresholds_proportions", &PerCellQCFilters_Results::thresholds_proportions)
-        .function("discard_sums", &PerCellQCFilters_Results::discard_sums)
-        .function("discard_detected", &PerCellQCFilters_Results::discard_detected)
-        .function("discard_proportions", &PerCellQCFilters_Results::discard_proportions)
-        .function("discard_overall", &PerCellQCFilters_Results::discard_overall)
-        .function("num_subsets", &PerCellQCFilters_Results::num_subsets)
+        .function("thresholds_sums", &js_bind<&PerCellQCFilters_Results::thresholds_sums>::fun)
+        .function("thresholds_detected", &js_bind<&PerCellQCFilters_Results::thresholds_detected>::fun)
+        .function("thresholds_proportions", &js_bind<&PerCellQCFilters_Results::thresholds_proportions>::fun)
+        .function("discard_sums", &js_bind<&PerCellQCFilters_Results::discard_sums>::fun)
+        .function("discard_detected", &js_bind<&PerCellQCFilters_Results::discard_detected>::fun)
+        .function("discard_proportions", &js_bind<&PerCellQCFilters_Results::discard_proportions>::fun)
+        .function("discard_overall", &js_bind<&PerCellQCFilters_Results::discard_overall>::fun)
+        .function("num_subsets", &js_bind<&PerCellQCFilters_Results::num_subsets>::fun)
         ;
 }
 /**
@@ -11,7 +11,9 @@
 #include <cstdint>
 #include <cmath>
 
-PerCellQCMetrics_Results per_cell_qc_metrics(const NumericMatrix& mat, int nsubsets, uintptr_t subsets, bool proportions) {
+PerCellQCMetrics_Results per_cell_qc_metrics(const NumericMatrix& mat, int nsubsets, uintptr_t subsets, bool proportions, int nthreads) {
+    ScopedExecutionContext scope(mat.execution_context(nthreads));
+
     scran::PerCellQCMetrics qc;
     qc.set_subset_totals(!proportions);
     auto store = qc.run(mat.ptr.get(), convert_array_of_offsets<const uint8_t*>(nsubsets, subsets));
@@ -19,14 +21,14 @@ PerCellQCMetrics_Results per_cell_qc_metrics(const NumericMatrix& mat, int nsubs
 }
 
 EMSCRIPTEN_BINDINGS(per_cell_qc_metrics) {
-    emscripten::function("per_cell_qc_metrics", &per_cell_qc_metrics);
+    emscripten::function("per_cell_qc_metrics", &js_bind<&per_cell_qc_metrics>::fun);
 
     emscripten::class_<PerCellQCMetrics_Results>("PerCellQCMetrics_Results")
-        .constructor<int, int, bool>()
-        .function("sums", &PerCellQCMetrics_Results::sums)
-        .function("detected", &PerCellQCMetrics_Results::detected)
-        .function("subset_proportions", &PerCellQCMetrics_Results::subset_proportions)
-        .function("num_subsets", &PerCellQCMetrics_Results::num_subsets)
-        .function("is_proportion", &PerCellQCMetrics_Results::is_proportion)
+        .constructor(&js_construct<PerCellQCMetrics_Results, int, int, bool>, emscripten::allow_raw_pointers())
+        .function("sums", &js_bind<&PerCellQCMetrics_Results::sums>::fun)
+        .function("detected", &js_bind<&PerCellQCMetrics_Results::detected>::fun)
+        .function("subset_proportions", &js_bind<&PerCellQCMetrics_Results::subset_proportions>::fun)
+        .function("num_subsets", &js_bind<&PerCellQCMetrics_Results::num_subsets>::fun)
+        .function("is_proportion", &js_bind<&PerCellQCMetrics_Results::is_proportion>::fun)
         ;
 }
@@ -5,106 +5,664 @@
 #include "NumericMatrix.h"
 
 #include "H5Cpp.h"
+#include "hdf5_loader.h"
+#include "hdf5_file_image.h"
 #include "tatami/ext/HDF5DenseMatrix.hpp"
 #include "tatami/ext/HDF5CompressedSparseMatrix.hpp"
-#include "tatami/ext/convert_to_layered_sparse.hpp"
+#include "layered_triplets.h"
 
-NumericMatrix read_hdf5_matrix(std::string path, std::string name) {
+#include <memory>
+#include <numeric>
+
+/**
+ * @brief Layered sparse matrices for different modalities, loaded from the same HDF5 file.
+ */
+struct SplitHdf5Matrices {
+    /**
+     * @return Number of modalities.
+     */
+    size_t size() const {
+        return matrices.size();
+    }
+
+    /**
+     * @param i Index of the modality.
+     * @return The matrix for modality `i`.
+     */
+    NumericMatrix get(size_t i) const {
+        return matrices[i];
+    }
+
+    /**
+     * @cond
+     */
+    std::vector<NumericMatrix> matrices;
+    /**
+     * @endcond
+     */
+};
+
+/**
+ * @cond
+ */
+struct Hdf5MatrixDetails {
     bool is_dense;
     bool csc = true;
     size_t nr, nc;
+};
 
-    try {
-        H5::H5File handle(path, H5F_ACC_RDONLY);
-        is_dense = (handle.childObjType(name) == H5O_TYPE_DATASET);
+inline Hdf5MatrixDetails inspect_hdf5_matrix(const H5::H5File& handle, const std::string& name) {
+    Hdf5MatrixDetails output;
+    output.is_dense = (handle.childObjType(name) == H5O_TYPE_DATASET);
+
+    if (output.is_dense) {
+        auto dspace = handle.openDataSet(name).getSpace();
+        if (dspace.getSimpleExtentNdims() != 2) {
+            throw std::runtime_error("dense matrix dataset should be 2-dimensional");
+        }
 
-        if (!is_dense) {
-            auto ohandle = handle.openGroup(name);
+        hsize_t dims[2];
+        dspace.getSimpleExtentDims(dims);
+        output.nr = dims[1]; // transposed, as rows in HDF5 are typically samples.
+        output.nc = dims[0];
 
-            auto check_shape = [](const auto& shandle) -> void {
-                auto sspace = shandle.getSpace();
-                if (sspace.getSimpleExtentNdims() != 1) {
-                    throw std::runtime_error("'shape' must be a 1-dimensional dataset");
-                }
+    } else {
+        auto ohandle = handle.openGroup(name);
+
+        auto check_shape = [](const auto& shandle) -> void {
+            auto sspace = shandle.getSpace();
+            if (sspace.getSimpleExtentNdims() != 1) {
+                throw std::runtime_error("'shape' must be a 1-dimensional dataset");
+            }
+
+            hsize_t shape_dim;
+            sspace.getSimpleExtentDims(&shape_dim);
+            if (shape_dim != 2) {
+                throw std::runtime_error("'shape' dataset should contain 2 elements");
+            }
+        };
+
+        if (ohandle.exists("shape")) { // 10x format.
+            auto shandle = ohandle.openDataSet("shape");
+            check_shape(shandle);
+
+            hsize_t dims[2];
+            shandle.read(dims, H5::PredType::NATIVE_HSIZE);
+            output.nr = dims[0];
+            output.nc = dims[1];
+
+        } else if (ohandle.attrExists("shape")) { // H5AD 
+            auto shandle = ohandle.openAttribute("shape");
+            check_shape(shandle);
+
+            hsize_t dims[2];
+            shandle.read(H5::PredType::NATIVE_HSIZE, dims);
+            output.nr = dims[1]; // yes, the flip is deliberate, because of how H5AD puts its features in the columns.
+            output.nc = dims[0];
+
+            if (!ohandle.attrExists("encoding-type")) {
+                throw std::runtime_error("expected an 'encoding-type' attribute for H5AD-like formats");
+            }
+            auto ehandle = ohandle.openAttribute("encoding-type");
+            H5std_string name;
+            H5::StrType stype = ehandle.getStrType();
+            ehandle.read(stype, name);
+
+            output.csc = (std::string(name) != std::string("csc_matrix")); // yes, the flip is deliberate, see above.
+
+        } else {
+            throw std::runtime_error("expected a 'shape' attribute or dataset");
+        }
+    }
+
+    return output;
+}
+
+/*
+ * Loading the requested rows and columns into a layered sparse matrix for
+ * each modality. Each loaded row is assigned to a modality and a position
+ * within that modality, and 'row_ids' contains the row in the file for each
+ * position. Rows are loaded in the order of 'rptr', if provided.
+ */
+template<class Opener>
+std::vector<NumericMatrix> load_layered_hdf5_matrices(Opener open, const std::string& name, const Hdf5MatrixDetails& details,
+    const std::vector<int>* rptr, const std::vector<int>* cptr,
+    const std::vector<int>& loaded_modality, const std::vector<int>& loaded_position, const std::vector<std::vector<size_t> >& row_ids,
+    const Hdf5LoadOptions& options, Hdf5ReadStats& stats)
+{
+    size_t nr = details.nr, nc = details.nc;
+    size_t NR = loaded_modality.size();
+    size_t NC = (cptr ? cptr->size() : nc);
+    int nmodalities = row_ids.size();
+
+    // Non-zero elements are counted and then filled directly into each
+    // modality's layered blocks, to avoid holding any intermediate copy of
+    // the elements alongside the loaded matrix.
+    std::vector<LayeredBlocks> blocks;
+    blocks.reserve(nmodalities);
+    auto create_blocks = [&](const std::vector<uint32_t>& row_max) -> void {
+        std::vector<std::vector<uint32_t> > modality_max(nmodalities);
+        for (int m = 0; m < nmodalities; ++m) {
+            modality_max[m].resize(row_ids[m].size());
+        }
+        for (size_t r = 0; r < NR; ++r) {
+            modality_max[loaded_modality[r]][loaded_position[r]] = row_max[r];
+        }
+        for (int m = 0; m < nmodalities; ++m) {
+            blocks.emplace_back(modality_max[m], NC);
+        }
+    };
 
-                hsize_t shape_dim;
-                sspace.getSimpleExtentDims(&shape_dim);
-                if (shape_dim != 2) {
-                    throw std::runtime_error("'shape' dataset should contain 2 elements");
+    auto check = [](int v) -> void {
+        if (v < 0) {
+            throw std::runtime_error("counts should be non-negative integers");
+        }
+    };
+
+    // For column-major matrices, each column is only processed by one thread,
+    // so the blocks can be counted and filled in parallel over columns.
+    auto process_columns = [&](auto for_each_in_column) -> void {
+        size_t nsegments = current_num_threads();
+        size_t per_segment = (NC + nsegments - 1) / nsegments;
+        std::vector<std::vector<uint32_t> > segment_max(nsegments, std::vector<uint32_t>(NR));
+        run_parallel(nsegments, [&](int first, int last) -> void {
+            for (int s = first; s < last; ++s) {
+                auto& current = segment_max[s];
+                size_t start = std::min(NC, s * per_segment), end = std::min(NC, start + per_segment);
+                for (size_t c = start; c < end; ++c) {
+                    for_each_in_column(c, [&](size_t r, int v) -> void {
+                        check(v);
+                        current[r] = std::max(current[r], static_cast<uint32_t>(v));
+                    });
                 }
-            };
+            }
+        });
 
-            if (ohandle.exists("shape")) { // 10x format.
-                auto shandle = ohandle.openDataSet("shape");
-                check_shape(shandle);
+        for (size_t s = 1; s < nsegments; ++s) {
+            for (size_t r = 0; r < NR; ++r) {
+                segment_max[0][r] = std::max(segment_max[0][r], segment_max[s][r]);
+            }
+        }
+        create_blocks(segment_max[0]);
+        segment_max.clear();
+
+        run_parallel(NC, [&](int first, int last) -> void {
+            for (int c = first; c < last; ++c) {
+                for_each_in_column(c, [&](size_t r, int) -> void {
+                    blocks[loaded_modality[r]].count(loaded_position[r], c);
+                });
+            }
+        });
 
-                hsize_t dims[2];
-                shandle.read(dims, H5::PredType::NATIVE_HSIZE);
-                nr = dims[0];
-                nc = dims[1];
+        for (auto& b : blocks) {
+            b.allocate();
+        }
+        run_parallel(NC, [&](int first, int last) -> void {
+            for (int c = first; c < last; ++c) {
+                for_each_in_column(c, [&](size_t r, int v) -> void {
+                    blocks[loaded_modality[r]].fill(loaded_position[r], c, v);
+                });
+            }
+        });
+    };
 
-            } else if (ohandle.attrExists("shape")) { // H5AD 
-                auto shandle = ohandle.openAttribute("shape");
-                check_shape(shandle);
+    // For row-major matrices, rows in the same block can share columns, so
+    // each block of each modality is only processed by one thread.
+    auto process_rows = [&](auto for_each_in_row) -> void {
+        std::vector<uint32_t> row_max(NR);
+        run_parallel(NR, [&](int first, int last) -> void {
+            for (int r = first; r < last; ++r) {
+                for_each_in_row(r, [&](size_t, int v) -> void {
+                    check(v);
+                    row_max[r] = std::max(row_max[r], static_cast<uint32_t>(v));
+                });
+            }
+        });
+        create_blocks(row_max);
+        std::vector<uint32_t>().swap(row_max);
 
-                hsize_t dims[2];
-                shandle.read(H5::PredType::NATIVE_HSIZE, dims);
-                nr = dims[1]; // yes, the flip is deliberate, because of how H5AD puts its features in the columns.
-                nc = dims[0];
+        std::vector<size_t> block_offset(nmodalities + 1);
+        for (int m = 0; m < nmodalities; ++m) {
+            block_offset[m + 1] = block_offset[m] + blocks[m].num_blocks();
+        }
+        std::vector<std::vector<int> > units(block_offset.back());
+        for (size_t r = 0; r < NR; ++r) {
+            auto m = loaded_modality[r];
+            units[block_offset[m] + blocks[m].block_of(loaded_position[r])].push_back(r);
+        }
 
-                if (!ohandle.attrExists("encoding-type")) {
-                    throw std::runtime_error("expected an 'encoding-type' attribute for H5AD-like formats");
+        run_parallel(units.size(), [&](int first, int last) -> void {
+            for (int u = first; u < last; ++u) {
+                for (auto r : units[u]) {
+                    auto& current = blocks[loaded_modality[r]];
+                    auto pos = loaded_position[r];
+                    for_each_in_row(r, [&](size_t c, int) -> void {
+                        current.count(pos, c);
+                    });
                 }
-                auto ehandle = ohandle.openAttribute("encoding-type");
-                H5std_string name;
-                H5::StrType stype = ehandle.getStrType();
-                ehandle.read(stype, name);
+            }
+        });
+
+        for (auto& b : blocks) {
+            b.allocate();
+        }
+        run_parallel(units.size(), [&](int first, int last) -> void {
+            for (int u = first; u < last; ++u) {
+                for (auto r : units[u]) {
+                    auto& current = blocks[loaded_modality[r]];
+                    auto pos = loaded_position[r];
+                    for_each_in_row(r, [&](size_t c, int v) -> void {
+                        current.fill(pos, c, v);
+                    });
+                }
+            }
+        });
+    };
 
-                csc = (std::string(name) != std::string("csc_matrix")); // yes, the flip is deliberate, see above.
+    try {
+        auto&& handle = open();
+        if (details.is_dense) {
+            auto loaded = load_hdf5_dense<int>(handle, name, cptr, rptr, "column", "row", options, stats);
+            process_columns([&](size_t c, auto fun) -> void {
+                auto current = loaded.data() + c * NR;
+                for (size_t r = 0; r < NR; ++r) {
+                    if (current[r]) {
+                        fun(r, current[r]);
+                    }
+                }
+            });
 
+        } else {
+            auto ghandle = handle.openGroup(name);
+            if (details.csc) {
+                auto loaded = load_hdf5_compressed_sparse<int, int>(ghandle, nc, nr, cptr, rptr, "column", "row", options, stats);
+                process_columns([&](size_t c, auto fun) -> void {
+                    for (size_t i = loaded.pointers[c], end = loaded.pointers[c + 1]; i < end; ++i) {
+                        if (loaded.values[i]) {
+                            fun(loaded.indices[i], loaded.values[i]);
+                        }
+                    }
+                });
             } else {
-                throw std::runtime_error("expected a 'shape' attribute or dataset");
+                auto loaded = load_hdf5_compressed_sparse<int, int>(ghandle, nr, nc, rptr, cptr, "row", "column", options, stats);
+                process_rows([&](size_t r, auto fun) -> void {
+                    for (size_t i = loaded.pointers[r], end = loaded.pointers[r + 1]; i < end; ++i) {
+                        if (loaded.values[i]) {
+                            fun(loaded.indices[i], loaded.values[i]);
+                        }
+                    }
+                });
             }
         }
     } catch (H5::Exception& e) {
         throw std::runtime_error(e.getCDetailMsg());
     }
 
-    std::shared_ptr<tatami::Matrix<int, int> > mat;
+    // The loaded matrix has already been released at this point.
+    std::vector<NumericMatrix> output;
+    output.reserve(nmodalities);
+    for (int m = 0; m < nmodalities; ++m) {
+        auto mat = blocks[m].build();
+        for (auto& i : mat.row_ids) {
+            i = row_ids[m][i];
+        }
+        output.push_back(std::move(mat));
+    }
+
+    return output;
+}
+
+template<class Opener>
+NumericMatrix read_hdf5_matrix_internal(Opener open, const std::string* path, const std::string& name, bool lazy, size_t cache_size,
+    bool use_row_subset, uintptr_t row_subset, size_t row_len,
+    bool use_col_subset, uintptr_t col_subset, size_t col_len,
+    size_t chunk_cache_size, size_t block_size, bool direct_chunk_read, uintptr_t read_stats,
+    int nthreads)
+{
+    if (lazy && path == NULL) {
+        throw std::runtime_error("lazy loading is not supported for in-memory HDF5 files");
+    }
+
+    ScopedExecutionContext scope{ ExecutionContext(nthreads) };
+
+    Hdf5MatrixDetails details;
     try {
-        if (is_dense) {
-            mat.reset(new tatami::HDF5DenseMatrix<int, int, true>(path, name));
-        } else if (csc) {
-            mat.reset(new tatami::HDF5CompressedSparseMatrix<false, int, int>(nr, nc, path, name + "/data", name + "/indices", name + "/indptr"));
-        } else {
-            mat.reset(new tatami::HDF5CompressedSparseMatrix<true, int, int>(nr, nc, path, name + "/data", name + "/indices", name + "/indptr"));
+        details = inspect_hdf5_matrix(open(), name);
+    } catch (H5::Exception& e) {
+        throw std::runtime_error(e.getCDetailMsg());
+    }
+    size_t nr = details.nr, nc = details.nc;
+
+    std::vector<int> rsub, csub;
+    if (use_row_subset) {
+        auto ptr = reinterpret_cast<const int32_t*>(row_subset);
+        rsub.insert(rsub.end(), ptr, ptr + row_len);
+        check_subset(rsub, nr, "row");
+    }
+    if (use_col_subset) {
+        auto ptr = reinterpret_cast<const int32_t*>(col_subset);
+        csub.insert(csub.end(), ptr, ptr + col_len);
+        check_subset(csub, nc, "column");
+    }
+
+    if (lazy) {
+        // Reading directly into doubles, as this will be used by all downstream functions.
+        std::shared_ptr<const tatami::NumericMatrix> mat;
+        try {
+            if (details.is_dense) {
+                mat.reset(new tatami::HDF5DenseMatrix<double, int, true>(*path, name, cache_size));
+            } else if (details.csc) {
+                mat.reset(new tatami::HDF5CompressedSparseMatrix<false, double, int>(nr, nc, *path, name + "/data", name + "/indices", name + "/indptr", cache_size));
+            } else {
+                mat.reset(new tatami::HDF5CompressedSparseMatrix<true, double, int>(nr, nc, *path, name + "/data", name + "/indices", name + "/indptr", cache_size));
+            }
+        } catch (H5::Exception& e) {
+            throw std::runtime_error(e.getCDetailMsg());
+        }
+
+        if (use_col_subset) {
+            mat = tatami::make_DelayedSubset<1>(std::move(mat), std::move(csub));
+        }
+
+        if (use_row_subset) {
+            std::vector<size_t> ids(rsub.begin(), rsub.end());
+            NumericMatrix output(tatami::make_DelayedSubset<0>(std::move(mat), std::move(rsub)), std::move(ids));
+            output.is_file_backed = true;
+            return output;
         }
+
+        NumericMatrix output(std::move(mat));
+        output.is_file_backed = true;
+        return output;
+    }
+
+    // Loading the requested subset into memory with large block reads. All
+    // HDF5 calls are made from this thread as the library isn't thread-safe,
+    // but decompression of directly-read chunks is done by the workers.
+    auto rptr = (use_row_subset ? &rsub : NULL);
+    auto cptr = (use_col_subset ? &csub : NULL);
+    size_t NR = (use_row_subset ? rsub.size() : nr);
+
+    // All loaded rows belong to a single modality, in the order in which they were requested.
+    std::vector<int> loaded_modality(NR), loaded_position(NR);
+    std::iota(loaded_position.begin(), loaded_position.end(), 0);
+    std::vector<std::vector<size_t> > row_ids(1);
+    if (use_row_subset) {
+        row_ids[0].insert(row_ids[0].end(), rsub.begin(), rsub.end());
+    } else {
+        row_ids[0].resize(nr);
+        std::iota(row_ids[0].begin(), row_ids[0].end(), 0);
+    }
+
+    Hdf5LoadOptions options;
+    options.chunk_cache_size = chunk_cache_size;
+    options.block_size = block_size;
+    options.direct_chunk_read = direct_chunk_read;
+    Hdf5ReadStats stats;
+
+    auto output = load_layered_hdf5_matrices(open, name, details, rptr, cptr, loaded_modality, loaded_position, row_ids, options, stats);
+
+    auto stats_ptr = reinterpret_cast<double*>(read_stats);
+    stats_ptr[0] = stats.bytes;
+    stats_ptr[1] = stats.calls;
+
+    return std::move(output.front());
+}
+
+template<class Opener>
+SplitHdf5Matrices read_hdf5_matrix_split_internal(Opener open, const std::string& name, uintptr_t modality, size_t modality_len, int nmodalities,
+    bool use_col_subset, uintptr_t col_subset, size_t col_len,
+    size_t chunk_cache_size, size_t block_size, bool direct_chunk_read, uintptr_t read_stats,
+    int nthreads)
+{
+    ScopedExecutionContext scope{ ExecutionContext(nthreads) };
+
+    Hdf5MatrixDetails details;
+    try {
+        details = inspect_hdf5_matrix(open(), name);
     } catch (H5::Exception& e) {
         throw std::runtime_error(e.getCDetailMsg());
     }
+    size_t nr = details.nr, nc = details.nc;
+    if (modality_len != nr) {
+        throw std::runtime_error("length of 'modality' should be equal to the number of rows");
+    }
+
+    // Assigning each row to its position within its modality. Rows that
+    // don't belong to any modality are not loaded at all.
+    auto mptr = reinterpret_cast<const int32_t*>(modality);
+    std::vector<std::vector<size_t> > row_ids(nmodalities);
+    std::vector<int> rsub, loaded_modality, loaded_position;
+    for (size_t r = 0; r < nr; ++r) {
+        auto m = mptr[r];
+        if (m < 0) {
+            continue;
+        }
+        if (m >= nmodalities) {
+            throw std::runtime_error("modality for each row should be less than the number of modalities");
+        }
+        rsub.push_back(r);
+        loaded_modality.push_back(m);
+        loaded_position.push_back(row_ids[m].size());
+        row_ids[m].push_back(r);
+    }
 
-    // The HDF5 library can't handle parallelization, and in any case, it's
-    // probably inefficient to lock on each read (especially given that we'd
-    // need a large number of small reads to maintain memory usage below its
-    // limit across all threads). So we just disable it.
-    enable_parallel = false;
-    tatami::LayeredMatrixData<double, int> output;
+    bool use_row_subset = (rsub.size() < nr);
+    std::vector<int> csub;
+    if (use_col_subset) {
+        auto ptr = reinterpret_cast<const int32_t*>(col_subset);
+        csub.insert(csub.end(), ptr, ptr + col_len);
+        check_subset(csub, nc, "column");
+    }
+
+    auto rptr = (use_row_subset ? &rsub : NULL);
+    auto cptr = (use_col_subset ? &csub : NULL);
+
+    Hdf5LoadOptions options;
+    options.chunk_cache_size = chunk_cache_size;
+    options.block_size = block_size;
+    options.direct_chunk_read = direct_chunk_read;
+    Hdf5ReadStats stats;
+
+    SplitHdf5Matrices output;
+    output.matrices = load_layered_hdf5_matrices(open, name, details, rptr, cptr, loaded_modality, loaded_position, row_ids, options, stats);
+
+    auto stats_ptr = reinterpret_cast<double*>(read_stats);
+    stats_ptr[0] = stats.bytes;
+    stats_ptr[1] = stats.calls;
+
+    return output;
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @param path Path to the HDF5 file.
+ * @param name Name of the dataset (for dense matrices) or group (for sparse matrices) inside the file.
+ * @param lazy Whether to keep the matrix in the file rather than loading it into memory.
+ * If `true`, values are read from the file on demand, so the file must exist for the lifetime of the returned `NumericMatrix`.
+ * All computations on a lazy matrix are serialized as the HDF5 library is not thread-safe.
+ * @param cache_size Size of the cache in bytes, used to hold blocks of rows or columns read from the file.
+ * Only used if `lazy = true`.
+ * @param use_row_subset Whether to load only a subset of rows.
+ * @param row_subset Offset to an integer array of length `row_len`, containing the row indices to load.
+ * Only used if `use_row_subset = true`, in which case the indices should be unique.
+ * @param row_len Length of the array in `row_subset`.
+ * @param use_col_subset Whether to load only a subset of columns.
+ * @param col_subset Offset to an integer array of length `col_len`, containing the column indices to load.
+ * Only used if `use_col_subset = true`.
+ * If `lazy = false` and the matrix is stored in a compressed sparse row format, the indices should be unique.
+ * @param col_len Length of the array in `col_subset`.
+ * @param chunk_cache_size Size of the raw data chunk cache for each dataset, in bytes.
+ * Only used if `lazy = false`.
+ * @param block_size Maximum size of each contiguous read, in bytes.
+ * Only used if `lazy = false`.
+ * @param direct_chunk_read Whether to read compressed chunks directly and decompress them in parallel, see `Hdf5LoadOptions::direct_chunk_read`.
+ * Only used if `lazy = false`.
+ * @param read_stats Offset to an output array of `double`s of length 2.
+ * If `lazy = false`, this is filled with the number of bytes read from the datasets and the number of read calls, see `Hdf5ReadStats`.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
+ *
+ * @return A `NumericMatrix` containing a layered sparse matrix if `lazy = false`,
+ * otherwise a matrix that reads from the file as needed.
+ * If `use_row_subset = true`, the row identities refer to the rows in the file.
+ *
+ * For in-memory matrices, the matrix is read in large blocks that are aligned to the dataset chunks.
+ * Subsets are loaded with hyperslab selections so that the rest of the file does not need to be read.
+ */
+NumericMatrix read_hdf5_matrix(std::string path, std::string name, bool lazy, size_t cache_size,
+    bool use_row_subset, uintptr_t row_subset, size_t row_len,
+    bool use_col_subset, uintptr_t col_subset, size_t col_len,
+    size_t chunk_cache_size, size_t block_size, bool direct_chunk_read, uintptr_t read_stats,
+    int nthreads)
+{
+    auto open = [&]() -> H5::H5File { return H5::H5File(path, H5F_ACC_RDONLY); };
+    return read_hdf5_matrix_internal(open, &path, name, lazy, cache_size,
+        use_row_subset, row_subset, row_len,
+        use_col_subset, col_subset, col_len,
+        chunk_cache_size, block_size, direct_chunk_read, read_stats,
+        nthreads);
+}
+
+/**
+ * @param buffer Offset to a `uint8_t` array containing the contents of a HDF5 file.
+ * This is used directly by the HDF5 library without any copies, see `Hdf5FileImage`.
+ * @param size Length of the array in `buffer`.
+ * @param name Name of the dataset (for dense matrices) or group (for sparse matrices) inside the file.
+ * @param use_row_subset Whether to load only a subset of rows.
+ * @param row_subset Offset to an integer array of length `row_len`, containing the row indices to load.
+ * Only used if `use_row_subset = true`, in which case the indices should be unique.
+ * @param row_len Length of the array in `row_subset`.
+ * @param use_col_subset Whether to load only a subset of columns.
+ * @param col_subset Offset to an integer array of length `col_len`, containing the column indices to load.
+ * Only used if `use_col_subset = true`.
+ * If the matrix is stored in a compressed sparse row format, the indices should be unique.
+ * @param col_len Length of the array in `col_subset`.
+ * @param chunk_cache_size Size of the raw data chunk cache for each dataset, in bytes.
+ * @param block_size Maximum size of each contiguous read, in bytes.
+ * @param direct_chunk_read Whether to read compressed chunks directly and decompress them in parallel, see `Hdf5LoadOptions::direct_chunk_read`.
+ * @param read_stats Offset to an output array of `double`s of length 2, see `read_hdf5_matrix()`.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
+ *
+ * @return A `NumericMatrix` containing a layered sparse matrix, as described for `read_hdf5_matrix()` with `lazy = false`.
+ * The matrix does not refer to `buffer`, which can be freed once this function returns.
+ */
+NumericMatrix read_hdf5_matrix_from_buffer(uintptr_t buffer, size_t size, std::string name,
+    bool use_row_subset, uintptr_t row_subset, size_t row_len,
+    bool use_col_subset, uintptr_t col_subset, size_t col_len,
+    size_t chunk_cache_size, size_t block_size, bool direct_chunk_read, uintptr_t read_stats,
+    int nthreads)
+{
+    std::unique_ptr<Hdf5FileImage> image;
     try {
-        output = tatami::convert_to_layered_sparse<double, int>(mat.get()); 
-    } catch (std::exception& e) {
-        enable_parallel = true;
-        throw e;
+        image.reset(new Hdf5FileImage(buffer, size));
+    } catch (H5::Exception& e) {
+        throw std::runtime_error(e.getCDetailMsg());
+    }
+
+    auto open = [&]() -> const H5::H5File& { return image->file(); };
+    return read_hdf5_matrix_internal(open, NULL, name, false, 0,
+        use_row_subset, row_subset, row_len,
+        use_col_subset, col_subset, col_len,
+        chunk_cache_size, block_size, direct_chunk_read, read_stats,
+        nthreads);
+}
+
+/**
+ * @param path Path to the HDF5 file.
+ * @param name Name of the dataset (for dense matrices) or group (for sparse matrices) inside the file.
+ * @param modality Offset to an integer array of length `modality_len`, specifying the modality of each row.
+ * Each entry should be less than `nmodalities`, and rows with negative values are not loaded.
+ * @param modality_len Length of the array in `modality`, which should be equal to the number of rows in the file.
+ * @param nmodalities Number of modalities.
+ * @param use_col_subset Whether to load only a subset of columns.
+ * @param col_subset Offset to an integer array of length `col_len`, containing the column indices to load.
+ * Only used if `use_col_subset = true`.
+ * If the matrix is stored in a compressed sparse row format, the indices should be unique.
+ * @param col_len Length of the array in `col_subset`.
+ * @param chunk_cache_size Size of the raw data chunk cache for each dataset, in bytes.
+ * @param block_size Maximum size of each contiguous read, in bytes.
+ * @param direct_chunk_read Whether to read compressed chunks directly and decompress them in parallel, see `Hdf5LoadOptions::direct_chunk_read`.
+ * @param read_stats Offset to an output array of `double`s of length 2, see `read_hdf5_matrix()`.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
+ *
+ * @return A separate layered sparse matrix for each modality, containing only the rows assigned to that modality.
+ * The row identities of each matrix refer to the rows in the file.
+ *
+ * The file is only read once, and the non-zero elements are counted and then copied directly into each modality's matrix.
+ * Peak memory usage is that of the loaded matrix plus the layered matrices for all modalities.
+ * This avoids creating a combined matrix that would then need to be subsetted by row for each modality.
+ */
+SplitHdf5Matrices read_hdf5_matrix_split(std::string path, std::string name, uintptr_t modality, size_t modality_len, int nmodalities,
+    bool use_col_subset, uintptr_t col_subset, size_t col_len,
+    size_t chunk_cache_size, size_t block_size, bool direct_chunk_read, uintptr_t read_stats,
+    int nthreads)
+{
+    auto open = [&]() -> H5::H5File { return H5::H5File(path, H5F_ACC_RDONLY); };
+    return read_hdf5_matrix_split_internal(open, name, modality, modality_len, nmodalities,
+        use_col_subset, col_subset, col_len,
+        chunk_cache_size, block_size, direct_chunk_read, read_stats,
+        nthreads);
+}
+
+/**
+ * @param buffer Offset to a `uint8_t` array containing the contents of a HDF5 file.
+ * This is used directly by the HDF5 library without any copies, see `Hdf5FileImage`.
+ * @param size Length of the array in `buffer`.
+ * @param name Name of the dataset (for dense matrices) or group (for sparse matrices) inside the file.
+ * @param modality Offset to an integer array containing the modality of each row, see `read_hdf5_matrix_split()`.
+ * @param modality_len Length of the array in `modality`.
+ * @param nmodalities Number of modalities.
+ * @param use_col_subset Whether to load only a subset of columns.
+ * @param col_subset Offset to an integer array of length `col_len`, containing the column indices to load.
+ * Only used if `use_col_subset = true`.
+ * If the matrix is stored in a compressed sparse row format, the indices should be unique.
+ * @param col_len Length of the array in `col_subset`.
+ * @param chunk_cache_size Size of the raw data chunk cache for each dataset, in bytes.
+ * @param block_size Maximum size of each contiguous read, in bytes.
+ * @param direct_chunk_read Whether to read compressed chunks directly and decompress them in parallel, see `Hdf5LoadOptions::direct_chunk_read`.
+ * @param read_stats Offset to an output array of `double`s of length 2, see `read_hdf5_matrix()`.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
+ *
+ * @return A separate layered sparse matrix for each modality, as described for `read_hdf5_matrix_split()`.
+ * The matrices do not refer to `buffer`, which can be freed once this function returns.
+ */
+SplitHdf5Matrices read_hdf5_matrix_split_from_buffer(uintptr_t buffer, size_t size, std::string name, uintptr_t modality, size_t modality_len, int nmodalities,
+    bool use_col_subset, uintptr_t col_subset, size_t col_len,
+    size_t chunk_cache_size, size_t block_size, bool direct_chunk_read, uintptr_t read_stats,
+    int nthreads)
+{
+    std::unique_ptr<Hdf5FileImage> image;
+    try {
+        image.reset(new Hdf5FileImage(buffer, size));
+    } catch (H5::Exception& e) {
+        throw std::runtime_error(e.getCDetailMsg());
     }
-    enable_parallel = true;
 
-    return NumericMatrix(std::move(output.matrix), permutation_to_indices(output.permutation));
+    auto open = [&]() -> const H5::H5File& { return image->file(); };
+    return read_hdf5_matrix_split_internal(open, name, modality, modality_len, nmodalities,
+        use_col_subset, col_subset, col_len,
+        chunk_cache_size, block_size, direct_chunk_read, read_stats,
+        nthreads);
 }
 
 /**
  * @cond
  */
 EMSCRIPTEN_BINDINGS(read_hdf5_matrix) {
-    emscripten::function("read_hdf5_matrix", &read_hdf5_matrix);
+    emscripten::function("read_hdf5_matrix", &js_bind<&read_hdf5_matrix>::fun);
+    emscripten::function("read_hdf5_matrix_from_buffer", &js_bind<&read_hdf5_matrix_from_buffer>::fun);
+    emscripten::function("read_hdf5_matrix_split", &js_bind<&read_hdf5_matrix_split>::fun);
+    emscripten::function("read_hdf5_matrix_split_from_buffer", &js_bind<&read_hdf5_matrix_split_from_buffer>::fun);
+
+    emscripten::class_<SplitHdf5Matrices>("SplitHdf5Matrices")
+        .function("size", &js_bind<&SplitHdf5Matrices::size>::fun)
+        .function("get", &js_bind<&SplitHdf5Matrices::get>::fun);
 }
 /**
  * @endcond
@@ -4,18 +4,63 @@
 #include "utils.h"
 #include "NumericMatrix.h"
 #include <cstdint>
+#include <cstdio>
 
 #include "tatami/ext/MatrixMarket_layered.hpp"
+#include "matrix_market.h"
 
-NumericMatrix read_matrix_market_from_buffer(uintptr_t buffer, int size, int compressed) {
-    unsigned char* bufptr = reinterpret_cast<unsigned char*>(buffer);
-    auto stuff = tatami::MatrixMarket::load_layered_sparse_matrix_from_buffer(bufptr, size, compressed);
-    return NumericMatrix(std::move(stuff.matrix), permutation_to_indices(stuff.permutation));
+/**
+ * @param buffer Offset to an array of `uint8_t`s containing the contents of a Matrix Market file.
+ * @param size Length of the array in `buffer`.
+ * @param compressed Whether the file is Gzip-compressed, see `MatrixMarketStream`.
+ * @param nthreads Number of threads to use for parsing.
+ * If zero, all threads in the pool are used.
+ *
+ * @return A `NumericMatrix` containing a layered sparse matrix.
+ *
+ * The buffer is parsed in multiple passes with `read_matrix_market_in_passes()`, so the triplets are never stored.
+ * Uncompressed text is parsed in place, while compressed text is inflated again in each pass.
+ */
+NumericMatrix read_matrix_market_from_buffer(uintptr_t buffer, int size, int compressed, int nthreads) {
+    ScopedExecutionContext scope{ ExecutionContext(nthreads) };
+    auto bufptr = reinterpret_cast<const unsigned char*>(buffer);
+    return read_matrix_market_in_passes(compressed, [&](MatrixMarketStream& stream) -> void {
+        stream.add(bufptr, size);
+    });
 }
 
-NumericMatrix read_matrix_market_from_file(std::string path, int compressed) {
-    auto stuff = tatami::MatrixMarket::load_layered_sparse_matrix_from_file(path.c_str(), compressed);
-    return NumericMatrix(std::move(stuff.matrix), permutation_to_indices(stuff.permutation));
+/**
+ * @param path Path to a Matrix Market file.
+ * @param compressed Whether the file is Gzip-compressed, see `MatrixMarketStream`.
+ * @param nthreads Number of threads to use for parsing.
+ * If zero, all threads in the pool are used.
+ *
+ * @return A `NumericMatrix` containing a layered sparse matrix.
+ *
+ * The file is read in chunks so that its contents do not need to be held in memory.
+ * It is read once for each pass of `read_matrix_market_in_passes()`, so the triplets are never stored.
+ */
+NumericMatrix read_matrix_market_from_file(std::string path, int compressed, int nthreads) {
+    ScopedExecutionContext scope{ ExecutionContext(nthreads) };
+    std::vector<unsigned char> buffer(16777216);
+
+    return read_matrix_market_in_passes(compressed, [&](MatrixMarketStream& stream) -> void {
+        std::unique_ptr<FILE, decltype(&std::fclose)> handle(std::fopen(path.c_str(), "rb"), &std::fclose);
+        if (!handle) {
+            throw std::runtime_error("failed to open the Matrix Market file at '" + path + "'");
+        }
+
+        while (true) {
+            size_t n = std::fread(buffer.data(), 1, buffer.size(), handle.get());
+            stream.add(buffer.data(), n);
+            if (n < buffer.size()) {
+                if (std::ferror(handle.get())) {
+                    throw std::runtime_error("failed to read the Matrix Market file at '" + path + "'");
+                }
+                break;
+            }
+        }
+    });
 }
 
 void read_matrix_market_header_from_buffer(uintptr_t buffer, int size, int compressed, uintptr_t output) {
@@ -38,9 +83,64 @@ void read_matrix_market_header_from_file(std::string path, int compressed, uintp
     return;
 }
 
+/**
+ * @brief Incremental reader for a Matrix Market file.
+ *
+ * This is a wrapper around `MatrixMarketStream`, allowing a file to be parsed in chunks as they are received (e.g., from a `ReadableStream`).
+ * Each chunk only needs to be on the Wasm heap for the duration of the call to `add()`.
+ */
+struct MatrixMarketReader {
+    /**
+     * @param compressed Whether the file is Gzip-compressed.
+     * This may be 1 (yes), 0 (no), or -1, in which case it is determined from the magic number at the start of the file.
+     * @param nthreads Number of threads to use for parsing.
+     * If zero, all threads in the pool are used.
+     */
+    MatrixMarketReader(int compressed, int nthreads) : stream(new MatrixMarketStream(compressed)), num_threads(nthreads) {}
+
+    /**
+     * @cond
+     */
+    std::unique_ptr<MatrixMarketStream> stream;
+    int num_threads;
+    /**
+     * @endcond
+     */
+
+    /**
+     * @param buffer Offset to an array of `uint8_t`s containing the next chunk of the file.
+     * @param size Length of the array in `buffer`.
+     */
+    void add(uintptr_t buffer, size_t size) {
+        if (!stream) {
+            throw std::runtime_error("cannot add chunks after calling 'finish()'");
+        }
+        ScopedExecutionContext scope{ ExecutionContext(num_threads) };
+        stream->add(reinterpret_cast<const unsigned char*>(buffer), size);
+    }
+
+    /**
+     * @return A `NumericMatrix` containing a layered sparse matrix.
+     * The parsed contents are released, so no further chunks can be added.
+     */
+    NumericMatrix finish() {
+        if (!stream) {
+            throw std::runtime_error("'finish()' has already been called");
+        }
+        ScopedExecutionContext scope{ ExecutionContext(num_threads) };
+        std::unique_ptr<MatrixMarketStream> current(std::move(stream));
+        return current->finish();
+    }
+};
+
 EMSCRIPTEN_BINDINGS(read_matrix_market) {
-    emscripten::function("read_matrix_market_from_buffer", &read_matrix_market_from_buffer);
-    emscripten::function("read_matrix_market_from_file", &read_matrix_market_from_file);
-    emscripten::function("read_matrix_market_header_from_buffer", &read_matrix_market_header_from_buffer);
-    emscripten::function("read_matrix_market_header_from_file", &read_matrix_market_header_from_file);
+    emscripten::function("read_matrix_market_from_buffer", &js_bind<&read_matrix_market_from_buffer>::fun);
+    emscripten::function("read_matrix_market_from_file", &js_bind<&read_matrix_market_from_file>::fun);
+    emscripten::function("read_matrix_market_header_from_buffer", &js_bind<&read_matrix_market_header_from_buffer>::fun);
+    emscripten::function("read_matrix_market_header_from_file", &js_bind<&read_matrix_market_header_from_file>::fun);
+
+    emscripten::class_<MatrixMarketReader>("MatrixMarketReader")
+        .constructor(&js_construct<MatrixMarketReader, int, int>, emscripten::allow_raw_pointers())
+        .function("add", &js_bind<&MatrixMarketReader::add>::fun)
+        .function("finish", &js_bind<&MatrixMarketReader::finish>::fun);
 }
@@ -4,6 +4,7 @@
 #include "scran/dimensionality_reduction/RunPCA.hpp"
 #include "scran/dimensionality_reduction/MultiBatchPCA.hpp"
 #include "scran/dimensionality_reduction/BlockedPCA.hpp"
+#include "utils.h"
 
 #include <vector>
 #include <cmath>
@@ -98,10 +99,14 @@ const uint8_t* precheck_inputs(int number, size_t NC, bool use_subset, uintptr_t
  * Only used if `use_subset = true`.
  * @param scale Whether to standardize rows in `mat` to unit variance.
  * If `true`, all rows in `mat` are assumed to have non-zero variance.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
  *
  * @return A `RunPCA_Results` object is returned containing the PCA results.
  */
-RunPCA_Results run_pca(const NumericMatrix& mat, int number, bool use_subset, uintptr_t subset, bool scale) {
+RunPCA_Results run_pca(const NumericMatrix& mat, int number, bool use_subset, uintptr_t subset, bool scale, int nthreads) {
+    ScopedExecutionContext scope(mat.execution_context(nthreads));
+
     auto ptr = mat.ptr;
     auto NR = ptr->nrow();
     auto NC = ptr->ncol();
@@ -135,10 +140,14 @@ using BlockedPCA_Results = PCA_Results<scran::BlockedPCA::Results>;
  * If `true`, all rows in `mat` are assumed to have non-zero variance.
  * @param[in] blocks Offset to an array of `int32_t`s with `ncells` elements, containing the block assignment for each cell.
  * Block IDs should be consecutive and 0-based.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
  *
  * @return A `BlockedPCA_Results` object is returned containing the PCA results.
  */
-BlockedPCA_Results run_blocked_pca(const NumericMatrix& mat, int number, bool use_subset, uintptr_t subset, bool scale, uintptr_t blocks) {
+BlockedPCA_Results run_blocked_pca(const NumericMatrix& mat, int number, bool use_subset, uintptr_t subset, bool scale, uintptr_t blocks, int nthreads) {
+    ScopedExecutionContext scope(mat.execution_context(nthreads));
+
     auto ptr = mat.ptr;
     auto NR = ptr->nrow();
     auto NC = ptr->ncol();
@@ -173,10 +182,14 @@ using MultiBatchPCA_Results = PCA_Results<scran::MultiBatchPCA::Results>;
  * If `true`, all rows in `mat` are assumed to have non-zero variance.
  * @param[in] blocks Offset to an array of `int32_t`s with `ncells` elements, containing the block assignment for each cell.
  * Block IDs should be consecutive and 0-based.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
  *
  * @return A `MultiBatchPCA_Results` object is returned containing the PCA results.
  */
-MultiBatchPCA_Results run_multibatch_pca(const NumericMatrix& mat, int number, bool use_subset, uintptr_t subset, bool scale, uintptr_t blocks) {
+MultiBatchPCA_Results run_multibatch_pca(const NumericMatrix& mat, int number, bool use_subset, uintptr_t subset, bool scale, uintptr_t blocks, int nthreads) {
+    ScopedExecutionContext scope(mat.execution_context(nthreads));
+
     auto ptr = mat.ptr;
     auto NR = ptr->nrow();
     auto NC = ptr->ncol();
@@ -195,34 +208,34 @@ MultiBatchPCA_Results run_multibatch_pca(const NumericMatrix& mat, int number, b
  * @cond
  */
 EMSCRIPTEN_BINDINGS(run_pca) {
-    emscripten::function("run_pca", &run_pca);
+    emscripten::function("run_pca", &js_bind<&run_pca>::fun);
 
-    emscripten::function("run_blocked_pca", &run_blocked_pca);
+    emscripten::function("run_blocked_pca", &js_bind<&run_blocked_pca>::fun);
 
-    emscripten::function("run_multibatch_pca", &run_multibatch_pca);
+    emscripten::function("run_multibatch_pca", &js_bind<&run_multibatch_pca>::fun);
 
     emscripten::class_<RunPCA_Results>("RunPCA_Results")
-        .function("pcs", &RunPCA_Results::pcs)
-        .function("variance_explained", &RunPCA_Results::variance_explained)
-        .function("total_variance", &RunPCA_Results::total_variance)
-        .function("num_cells", &RunPCA_Results::num_cells)
-        .function("num_pcs", &RunPCA_Results::num_pcs)
+        .function("pcs", &js_bind<&RunPCA_Results::pcs>::fun)
+        .function("variance_explained", &js_bind<&RunPCA_Results::variance_explained>::fun)
+        .function("total_variance", &js_bind<&RunPCA_Results::total_variance>::fun)
+        .function("num_cells", &js_bind<&RunPCA_Results::num_cells>::fun)
+        .function("num_pcs", &js_bind<&RunPCA_Results::num_pcs>::fun)
         ;
 
     emscripten::class_<BlockedPCA_Results>("BlockedPCA_Results")
-        .function("pcs", &BlockedPCA_Results::pcs)
-        .function("variance_explained", &BlockedPCA_Results::variance_explained)
-        .function("total_variance", &BlockedPCA_Results::total_variance)
-        .function("num_cells", &BlockedPCA_Results::num_cells)
-        .function("num_pcs", &BlockedPCA_Results::num_pcs)
+        .function("pcs", &js_bind<&BlockedPCA_Results::pcs>::fun)
+        .function("variance_explained", &js_bind<&BlockedPCA_Results::variance_explained>::fun)
+        .function("total_variance", &js_bind<&BlockedPCA_Results::total_variance>::fun)
+        .function("num_cells", &js_bind<&BlockedPCA_Results::num_cells>::fun)
+        .function("num_pcs", &js_bind<&BlockedPCA_Results::num_pcs>::fun)
         ;
 
     emscripten::class_<MultiBatchPCA_Results>("MultiBatchPCA_Results")
-        .function("pcs", &MultiBatchPCA_Results::pcs)
-        .function("variance_explained", &MultiBatchPCA_Results::variance_explained)
-        .function("total_variance", &MultiBatchPCA_Results::total_variance)
-        .function("num_cells", &MultiBatchPCA_Results::num_cells)
-        .function("num_pcs", &MultiBatchPCA_Results::num_pcs)
+        .function("pcs", &js_bind<&MultiBatchPCA_Results::pcs>::fun)
+        .function("variance_explained", &js_bind<&MultiBatchPCA_Results::variance_explained>::fun)
+        .function("total_variance", &js_bind<&MultiBatchPCA_Results::total_variance>::fun)
+        .function("num_cells", &js_bind<&MultiBatchPCA_Results::num_cells>::fun)
+        .function("num_pcs", &js_bind<&MultiBatchPCA_Results::num_pcs>::fun)
         ;
 }
 /**
@@ -152,10 +152,14 @@ BuiltSinglePPReference build_singlepp_reference(size_t nfeatures, uintptr_t mat_
  * @param quantile Quantile on the correlations to use when computing a score for each label.
  * @param[out] output Offset to an integer array of length equal to the number of columns in `mat`.
  * This will be filled with the index of the assigned label for each cell in the test dataset.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
  *
  * @return `output` is filled with the label assignments from the reference dataset.
  */
-void run_singlepp(const NumericMatrix& mat, const BuiltSinglePPReference& built, double quantile, uintptr_t output) {
+void run_singlepp(const NumericMatrix& mat, const BuiltSinglePPReference& built, double quantile, uintptr_t output, int nthreads) {
+    ScopedExecutionContext scope(mat.execution_context(nthreads));
+
     std::vector<double*> empty(built.num_labels(), nullptr);
     singlepp::SinglePP runner;
     runner.set_quantile(quantile);
@@ -247,10 +251,14 @@ IntegratedSinglePPReferences integrate_singlepp_references(
  * @param quantile Quantile on the correlations to use when computing a score for each label.
  * @param[out] output Offset to an integer array of length equal to the number of columns in `mat`.
  * This will be filled with the index of the reference with the top-scoring label for each cell in the test dataset.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
  *
  * @return `output` is filled with the reference indices.
  */
-void integrate_singlepp(const NumericMatrix& mat, uintptr_t assigned, const IntegratedSinglePPReferences& integrated, double quantile, uintptr_t output) {
+void integrate_singlepp(const NumericMatrix& mat, uintptr_t assigned, const IntegratedSinglePPReferences& integrated, double quantile, uintptr_t output, int nthreads) {
+    ScopedExecutionContext scope(mat.execution_context(nthreads));
+
     std::vector<double*> empty(integrated.num_references(), nullptr);
     auto aptrs = convert_array_of_offsets<const int*>(integrated.num_references(), assigned);
 
@@ -272,29 +280,29 @@ void integrate_singlepp(const NumericMatrix& mat, uintptr_t assigned, const Inte
  * @cond
  */
 EMSCRIPTEN_BINDINGS(run_singlepp) {
-    emscripten::function("run_singlepp", &run_singlepp);
+    emscripten::function("run_singlepp", &js_bind<&run_singlepp>::fun);
 
-    emscripten::function("load_singlepp_reference", &load_singlepp_reference);
+    emscripten::function("load_singlepp_reference", &js_bind<&load_singlepp_reference>::fun);
 
-    emscripten::function("build_singlepp_reference", &build_singlepp_reference);
+    emscripten::function("build_singlepp_reference", &js_bind<&build_singlepp_reference>::fun);
 
-    emscripten::function("integrate_singlepp_references", &integrate_singlepp_references);
+    emscripten::function("integrate_singlepp_references", &js_bind<&integrate_singlepp_references>::fun);
 
-    emscripten::function("integrate_singlepp", &integrate_singlepp);
+    emscripten::function("integrate_singlepp", &js_bind<&integrate_singlepp>::fun);
     
     emscripten::class_<SinglePPReference>("SinglePPReference")
-        .function("num_samples", &SinglePPReference::num_samples)
-        .function("num_features", &SinglePPReference::num_features)
-        .function("num_labels", &SinglePPReference::num_labels)
+        .function("num_samples", &js_bind<&SinglePPReference::num_samples>::fun)
+        .function("num_features", &js_bind<&SinglePPReference::num_features>::fun)
+        .function("num_labels", &js_bind<&SinglePPReference::num_labels>::fun)
         ;
 
     emscripten::class_<BuiltSinglePPReference>("BuiltSinglePPReference")
-        .function("shared_features", &BuiltSinglePPReference::shared_features)
-        .function("num_labels", &BuiltSinglePPReference::num_labels)
+        .function("shared_features", &js_bind<&BuiltSinglePPReference::shared_features>::fun)
+        .function("num_labels", &js_bind<&BuiltSinglePPReference::num_labels>::fun)
         ;
 
     emscripten::class_<IntegratedSinglePPReferences>("IntegratedSinglePPReferences")
-        .function("num_references", &IntegratedSinglePPReferences::num_references)
+        .function("num_references", &js_bind<&IntegratedSinglePPReferences::num_references>::fun)
         ;
 }
 /**
@@ -71,7 +71,7 @@ TsneStatus initialize_tsne(const NeighborResults& neighbors, double perplexity)
     qdtsne::Tsne factory;
     factory.set_perplexity(perplexity);
     factory.set_max_depth(7); // speed up iterations, avoid problems with duplicates.
-    return TsneStatus(factory.template initialize<>(neighbors.neighbors));
+    return TsneStatus(factory.template initialize<>(neighbors.to_list()));
 }
 
 /**
@@ -132,18 +132,18 @@ void run_tsne(TsneStatus& status, int runtime, int maxiter, uintptr_t Y) {
  * @cond
  */
 EMSCRIPTEN_BINDINGS(run_tsne) {
-    emscripten::function("perplexity_to_k", &perplexity_to_k);
+    emscripten::function("perplexity_to_k", &js_bind<&perplexity_to_k>::fun);
 
-    emscripten::function("initialize_tsne", &initialize_tsne);
+    emscripten::function("initialize_tsne", &js_bind<&initialize_tsne>::fun);
 
-    emscripten::function("randomize_tsne_start", &randomize_tsne_start);
+    emscripten::function("randomize_tsne_start", &js_bind<&randomize_tsne_start>::fun);
 
-    emscripten::function("run_tsne", &run_tsne);
+    emscripten::function("run_tsne", &js_bind<&run_tsne>::fun);
 
     emscripten::class_<TsneStatus>("TsneStatus")
-        .function("iterations", &TsneStatus::iterations)
-        .function("deepcopy", &TsneStatus::deepcopy)
-        .function("num_obs", &TsneStatus::num_obs);
+        .function("iterations", &js_bind<&TsneStatus::iterations>::fun)
+        .function("deepcopy", &js_bind<&TsneStatus::deepcopy>::fun)
+        .function("num_obs", &js_bind<&TsneStatus::num_obs>::fun);
 }
 /**
  * @endcond
@@ -87,7 +87,7 @@ UmapStatus initialize_umap(const NeighborResults& neighbors, int num_epochs, dou
 
     // Don't move from neighbors; this means that we can easily re-use the
     // existing neighbors if someone wants to change the number of epochs.
-    return UmapStatus(factory.initialize(neighbors.neighbors, 2, embedding));
+    return UmapStatus(factory.initialize(neighbors.to_list(), 2, embedding));
 }
 
 /**
@@ -124,15 +124,15 @@ void run_umap(UmapStatus& status, int runtime, uintptr_t Y) {
  * @cond
  */
 EMSCRIPTEN_BINDINGS(run_umap) {
-    emscripten::function("initialize_umap", &initialize_umap);
+    emscripten::function("initialize_umap", &js_bind<&initialize_umap>::fun);
 
-    emscripten::function("run_umap", &run_umap);
+    emscripten::function("run_umap", &js_bind<&run_umap>::fun);
 
     emscripten::class_<UmapStatus>("UmapStatus")
-        .function("epoch", &UmapStatus::epoch)
-        .function("num_epochs", &UmapStatus::num_epochs)
-        .function("num_obs", &UmapStatus::num_obs)
-        .function("deepcopy", &UmapStatus::deepcopy);
+        .function("epoch", &js_bind<&UmapStatus::epoch>::fun)
+        .function("num_epochs", &js_bind<&UmapStatus::num_epochs>::fun)
+        .function("num_obs", &js_bind<&UmapStatus::num_obs>::fun)
+        .function("deepcopy", &js_bind<&UmapStatus::deepcopy>::fun);
 }
 /**
  * @endcond
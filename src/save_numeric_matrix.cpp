@@ -0,0 +1,563 @@
+#include <emscripten.h>
+#include <emscripten/bind.h>
+
+#include "utils.h"
+#include "NumericMatrix.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+/**
+ * @file save_numeric_matrix.cpp
+ *
+ * @brief Save and load layered sparse matrices in a native binary format.
+ *
+ * The snapshot contains the components of the layered sparse matrix, i.e., the compressed sparse column arrays for each block of rows, along with the row identities.
+ * Loading a snapshot only involves reading these arrays back into memory, so it avoids the cost of parsing and reconversion from Matrix Market or HDF5 files.
+ *
+ * The file has the following layout, with all integers stored in little-endian order (as on Wasm):
+ *
+ * - An 8-byte magic string `SCRANMAT`.
+ * - A 32-bit version number, currently 1.
+ * - A 32-bit flag field, where the least significant bit indicates whether the row identities are stored.
+ * - 64-bit integers containing the number of rows, columns and blocks.
+ * - For each block, a 32-bit integer containing the number of bytes per value (1, 2 or 4), 32 bits of padding,
+ *   and 64-bit integers containing the number of rows and non-zero elements in the block.
+ * - If the row identities are stored, a 64-bit integer for each row.
+ * - For each block, the column pointers as 64-bit integers, the row indices as 16-bit integers, and the values.
+ *
+ * Each array starts at an offset that is a multiple of 8 bytes from the start of the file, so that it can be used directly from a memory-mapped file.
+ */
+
+/**
+ * @cond
+ */
+namespace snapshot {
+
+constexpr char magic[8] = { 'S', 'C', 'R', 'A', 'N', 'M', 'A', 'T' };
+
+constexpr uint32_t version = 1;
+
+constexpr size_t block_size = 65536;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t nrow;
+    uint64_t ncol;
+    uint64_t nblocks;
+};
+
+struct BlockDetails {
+    uint32_t value_bytes;
+    uint32_t padding;
+    uint64_t nrow;
+    uint64_t nnz;
+};
+
+static_assert(sizeof(Header) == 40 && sizeof(BlockDetails) == 24, "unexpected padding in the snapshot header");
+
+inline size_t padding(size_t n) {
+    return (8 - n % 8) % 8;
+}
+
+struct Block {
+    Block(uint32_t b = 1, size_t nr = 0, size_t nc = 0) : value_bytes(b), nrow(nr), pointers(nc + 1) {}
+
+    uint32_t value_bytes;
+    size_t nrow;
+    std::vector<size_t> pointers;
+    std::vector<uint16_t> indices;
+    std::vector<uint8_t> values8;
+    std::vector<uint16_t> values16;
+    std::vector<uint32_t> values32;
+
+    void allocate() {
+        size_t nnz = pointers.back();
+        indices.resize(nnz);
+        if (value_bytes == 1) {
+            values8.resize(nnz);
+        } else if (value_bytes == 2) {
+            values16.resize(nnz);
+        } else {
+            values32.resize(nnz);
+        }
+    }
+
+    void set(size_t i, uint32_t v) {
+        if (value_bytes == 1) {
+            values8[i] = v;
+        } else if (value_bytes == 2) {
+            values16[i] = v;
+        } else {
+            values32[i] = v;
+        }
+    }
+
+    const void* values() const {
+        if (value_bytes == 1) {
+            return values8.data();
+        } else if (value_bytes == 2) {
+            return values16.data();
+        } else {
+            return values32.data();
+        }
+    }
+
+    void* values() {
+        return const_cast<void*>(static_cast<const Block*>(this)->values());
+    }
+
+    template<typename Value>
+    std::shared_ptr<const tatami::NumericMatrix> create(std::vector<Value>& vals, size_t ncol) {
+        return std::shared_ptr<const tatami::NumericMatrix>(
+            new tatami::CompressedSparseMatrix<false, double, int, std::vector<Value>, std::vector<uint16_t>, std::vector<size_t> >(
+                nrow, ncol, std::move(vals), std::move(indices), std::move(pointers)
+            )
+        );
+    }
+
+    std::shared_ptr<const tatami::NumericMatrix> create(size_t ncol) {
+        if (value_bytes == 1) {
+            return create(values8, ncol);
+        } else if (value_bytes == 2) {
+            return create(values16, ncol);
+        } else {
+            return create(values32, ncol);
+        }
+    }
+};
+
+inline uint32_t check_value(double v) {
+    if (v < 0 || v > UINT32_MAX || v != std::floor(v)) {
+        throw std::runtime_error("only matrices of non-negative integers can be saved");
+    }
+    return v;
+}
+
+/*
+ * Writing the snapshot.
+ */
+
+class Writer {
+public:
+    Writer(const std::string& path) : handle(std::fopen(path.c_str(), "wb"), &std::fclose), path(path) {
+        if (!handle) {
+            throw std::runtime_error("failed to open '" + path + "' for writing");
+        }
+    }
+
+    void write(const void* ptr, size_t n) {
+        if (n && std::fwrite(ptr, 1, n, handle.get()) != n) {
+            throw std::runtime_error("failed to write to '" + path + "'");
+        }
+        written += n;
+    }
+
+    void pad() {
+        const char zeros[8] = { 0 };
+        write(zeros, padding(written));
+    }
+
+    void close() {
+        if (std::fclose(handle.release())) {
+            throw std::runtime_error("failed to close '" + path + "'");
+        }
+    }
+
+private:
+    std::unique_ptr<FILE, decltype(&std::fclose)> handle;
+    std::string path;
+    size_t written = 0;
+};
+
+template<class Input>
+void write_as_uint64(Writer& writer, const std::vector<Input>& x) {
+    if constexpr(sizeof(Input) == 8) {
+        writer.write(x.data(), x.size() * 8);
+    } else {
+        constexpr size_t buffer_size = 65536;
+        std::vector<uint64_t> buffer;
+        buffer.reserve(buffer_size);
+        for (size_t start = 0; start < x.size(); start += buffer_size) {
+            buffer.clear();
+            size_t end = std::min(start + buffer_size, x.size());
+            buffer.insert(buffer.end(), x.begin() + start, x.begin() + end);
+            writer.write(buffer.data(), buffer.size() * 8);
+        }
+    }
+}
+
+/*
+ * Reading the snapshot.
+ */
+
+class FileSource {
+public:
+    FileSource(const std::string& path) : handle(std::fopen(path.c_str(), "rb"), &std::fclose), path(path) {
+        if (!handle) {
+            throw std::runtime_error("failed to open '" + path + "' for reading");
+        }
+    }
+
+    void read(void* ptr, size_t n) {
+        if (n && std::fread(ptr, 1, n, handle.get()) != n) {
+            throw std::runtime_error("failed to read from '" + path + "', file is truncated or corrupted");
+        }
+        consumed += n;
+    }
+
+    void pad() {
+        char discard[8];
+        read(discard, padding(consumed));
+    }
+
+private:
+    std::unique_ptr<FILE, decltype(&std::fclose)> handle;
+    std::string path;
+    size_t consumed = 0;
+};
+
+class BufferSource {
+public:
+    BufferSource(const unsigned char* p, size_t n) : ptr(p), size(n) {}
+
+    void read(void* dest, size_t n) {
+        if (n > size - consumed) {
+            throw std::runtime_error("snapshot buffer is truncated or corrupted");
+        }
+        std::memcpy(dest, ptr + consumed, n);
+        consumed += n;
+    }
+
+    void pad() {
+        size_t n = std::min(padding(consumed), size - consumed);
+        consumed += n;
+    }
+
+private:
+    const unsigned char* ptr;
+    size_t size;
+    size_t consumed = 0;
+};
+
+template<class Output, class Source>
+void read_as_uint64(Source& source, std::vector<Output>& x, uint64_t limit) {
+    constexpr size_t buffer_size = 65536;
+    std::vector<uint64_t> buffer;
+    for (size_t start = 0; start < x.size(); start += buffer_size) {
+        size_t end = std::min(start + buffer_size, x.size());
+        buffer.resize(end - start);
+        source.read(buffer.data(), buffer.size() * 8);
+        for (size_t i = start; i < end; ++i) {
+            auto v = buffer[i - start];
+            if (v > limit) {
+                throw std::runtime_error("out-of-range value in the snapshot, file may be corrupted");
+            }
+            x[i] = v;
+        }
+    }
+}
+
+template<class Source>
+NumericMatrix load(Source& source) {
+    Header header;
+    source.read(&header, sizeof(Header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("file is not a ScranMatrix snapshot");
+    }
+    if (header.version != version) {
+        throw std::runtime_error("unsupported snapshot version " + std::to_string(header.version));
+    }
+    if (header.nrow > INT32_MAX || header.ncol > INT32_MAX) {
+        throw std::runtime_error("dimensions of the snapshot are too large");
+    }
+    size_t nrow = header.nrow, ncol = header.ncol;
+
+    std::vector<Block> blocks;
+    blocks.reserve(std::min(header.nblocks, static_cast<uint64_t>(nrow / block_size + 3)));
+    uint64_t total_rows = 0;
+    for (uint64_t b = 0; b < header.nblocks; ++b) {
+        BlockDetails details;
+        source.read(&details, sizeof(BlockDetails));
+        if ((details.value_bytes != 1 && details.value_bytes != 2 && details.value_bytes != 4) || details.nrow > block_size || details.nnz > SIZE_MAX) {
+            throw std::runtime_error("invalid block details in the snapshot, file may be corrupted");
+        }
+        total_rows += details.nrow;
+        if (total_rows > nrow) {
+            throw std::runtime_error("block dimensions are not consistent with the snapshot dimensions");
+        }
+        blocks.emplace_back(details.value_bytes, details.nrow, ncol);
+        blocks.back().pointers.back() = details.nnz;
+    }
+    if (total_rows != nrow) {
+        throw std::runtime_error("block dimensions are not consistent with the snapshot dimensions");
+    }
+
+    bool reorganized = header.flags & 1;
+    std::vector<size_t> ids;
+    if (reorganized) {
+        ids.resize(nrow);
+        read_as_uint64(source, ids, SIZE_MAX);
+    }
+
+    for (auto& block : blocks) {
+        size_t nnz = block.pointers.back();
+        block.allocate();
+        read_as_uint64(source, block.pointers, nnz);
+        if (block.pointers.front() != 0 || block.pointers.back() != nnz || !std::is_sorted(block.pointers.begin(), block.pointers.end())) {
+            throw std::runtime_error("invalid column pointers in the snapshot, file may be corrupted");
+        }
+
+        source.read(block.indices.data(), nnz * sizeof(uint16_t));
+        source.pad();
+        if (std::any_of(block.indices.begin(), block.indices.end(), [&](uint16_t i) -> bool { return i >= block.nrow; })) {
+            throw std::runtime_error("invalid row indices in the snapshot, file may be corrupted");
+        }
+
+        source.read(block.values(), nnz * block.value_bytes);
+        source.pad();
+    }
+
+    std::shared_ptr<const tatami::NumericMatrix> mat;
+    if (blocks.size() == 1) {
+        mat = blocks.front().create(ncol);
+    } else if (blocks.empty()) {
+        mat = Block(1, 0, ncol).create(ncol);
+    } else {
+        std::vector<std::shared_ptr<const tatami::NumericMatrix> > collected;
+        collected.reserve(blocks.size());
+        for (auto& block : blocks) {
+            collected.push_back(block.create(ncol));
+        }
+        mat = tatami::make_DelayedBind<0>(std::move(collected));
+    }
+
+    if (reorganized) {
+        return NumericMatrix(std::move(mat), std::move(ids));
+    } else {
+        return NumericMatrix(std::move(mat));
+    }
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @param mat A `NumericMatrix` containing non-negative integers, typically a layered sparse matrix from one of the `read_*` functions.
+ * @param path Path to the output file.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
+ *
+ * @return A snapshot of `mat` is saved to `path`.
+ *
+ * If `mat` is already a layered sparse matrix, its rows are saved in the same order.
+ * Otherwise, the rows are reorganized into the layered representation and the row identities are updated accordingly.
+ */
+void save_numeric_matrix(const NumericMatrix& mat, std::string path, int nthreads) {
+    ScopedExecutionContext scope{ mat.execution_context(nthreads) };
+    const auto& ptr = mat.ptr;
+    size_t nrow = ptr->nrow(), ncol = ptr->ncol();
+
+    // Applies a function to the non-zero elements of each column in [first, last).
+    auto extract = [&](size_t first, size_t last, auto fun) -> void {
+        auto wrk = ptr->new_workspace(false);
+        std::vector<double> vbuffer(nrow);
+        std::vector<int> ibuffer(nrow);
+        for (size_t c = first; c < last; ++c) {
+            auto range = ptr->sparse_column(c, vbuffer.data(), ibuffer.data(), wrk.get());
+            fun(c, range);
+        }
+    };
+
+    // Finding the maximum of each row to choose its value type. Columns are
+    // split into one segment per thread, each with its own vector of maxima.
+    std::vector<uint32_t> row_max(nrow);
+    {
+        size_t nseg = std::max(1, current_num_threads());
+        std::vector<std::vector<uint32_t> > seg_max(nseg);
+        run_parallel(nseg, [&](int first, int last) -> void {
+            for (int s = first; s < last; ++s) {
+                auto& current = seg_max[s];
+                current.resize(nrow);
+                extract((ncol * s) / nseg, (ncol * (s + 1)) / nseg, [&](size_t, const auto& range) -> void {
+                    for (int i = 0; i < range.number; ++i) {
+                        auto v = snapshot::check_value(range.value[i]);
+                        auto& m = current[range.index[i]];
+                        if (m < v) {
+                            m = v;
+                        }
+                    }
+                });
+            }
+        }, 1);
+
+        for (auto& current : seg_max) {
+            for (size_t r = 0; r < nrow; ++r) {
+                row_max[r] = std::max(row_max[r], current[r]);
+            }
+            std::vector<uint32_t>().swap(current);
+        }
+    }
+
+    // Assigning rows to blocks in the same manner as the layered loaders.
+    std::vector<uint8_t> category(nrow);
+    std::vector<size_t> position(nrow);
+    size_t counts[3] = { 0, 0, 0 };
+    for (size_t r = 0; r < nrow; ++r) {
+        auto m = row_max[r];
+        uint8_t cat = (m <= 255 ? 0 : (m <= 65535 ? 1 : 2));
+        category[r] = cat;
+        position[r] = counts[cat];
+        ++counts[cat];
+    }
+    std::vector<uint32_t>().swap(row_max);
+
+    constexpr size_t block_size = snapshot::block_size;
+    size_t block_start[4];
+    block_start[0] = 0;
+    for (int cat = 0; cat < 3; ++cat) {
+        block_start[cat + 1] = block_start[cat] + (counts[cat] + block_size - 1) / block_size;
+    }
+    size_t nblocks = block_start[3];
+
+    std::vector<snapshot::Block> blocks;
+    blocks.reserve(nblocks);
+    for (int cat = 0; cat < 3; ++cat) {
+        for (size_t b = block_start[cat]; b < block_start[cat + 1]; ++b) {
+            size_t nr = std::min(block_size, counts[cat] - (b - block_start[cat]) * block_size);
+            blocks.emplace_back(1u << cat, nr, ncol);
+        }
+    }
+
+    auto block_of = [&](int r) -> size_t {
+        return block_start[category[r]] + position[r] / block_size;
+    };
+
+    // Counting and then filling the non-zero elements in each column of each
+    // block. Each column is only processed by one thread, so no locking.
+    run_parallel(ncol, [&](int first, int last) -> void {
+        extract(first, last, [&](size_t c, const auto& range) -> void {
+            for (int i = 0; i < range.number; ++i) {
+                ++(blocks[block_of(range.index[i])].pointers[c + 1]);
+            }
+        });
+    });
+
+    for (auto& block : blocks) {
+        for (size_t c = 0; c < ncol; ++c) {
+            block.pointers[c + 1] += block.pointers[c];
+        }
+        block.allocate();
+    }
+
+    run_parallel(ncol, [&](int first, int last) -> void {
+        std::vector<size_t> cursors(nblocks);
+        extract(first, last, [&](size_t c, const auto& range) -> void {
+            for (size_t b = 0; b < nblocks; ++b) {
+                cursors[b] = blocks[b].pointers[c];
+            }
+            for (int i = 0; i < range.number; ++i) {
+                auto r = range.index[i];
+                auto b = block_of(r);
+                auto& block = blocks[b];
+                auto& cur = cursors[b];
+                block.indices[cur] = position[r] % block_size;
+                block.set(cur, range.value[i]);
+                ++cur;
+            }
+        });
+    });
+
+    // Row identities are only stored if they are non-trivial.
+    std::vector<size_t> ids(nrow);
+    {
+        size_t offsets[3] = { 0, counts[0], counts[0] + counts[1] };
+        for (size_t r = 0; r < nrow; ++r) {
+            ids[offsets[category[r]] + position[r]] = (mat.is_reorganized ? mat.row_ids[r] : r);
+        }
+    }
+    bool reorganized = mat.is_reorganized;
+    for (size_t r = 0; r < nrow && !reorganized; ++r) {
+        reorganized = (ids[r] != r);
+    }
+
+    snapshot::Writer writer(path);
+    snapshot::Header header;
+    std::memcpy(header.magic, snapshot::magic, sizeof(snapshot::magic));
+    header.version = snapshot::version;
+    header.flags = reorganized;
+    header.nrow = nrow;
+    header.ncol = ncol;
+    header.nblocks = nblocks;
+    writer.write(&header, sizeof(header));
+
+    for (const auto& block : blocks) {
+        snapshot::BlockDetails details;
+        details.value_bytes = block.value_bytes;
+        details.padding = 0;
+        details.nrow = block.nrow;
+        details.nnz = block.pointers.back();
+        writer.write(&details, sizeof(details));
+    }
+
+    if (reorganized) {
+        snapshot::write_as_uint64(writer, ids);
+    }
+
+    for (const auto& block : blocks) {
+        size_t nnz = block.pointers.back();
+        snapshot::write_as_uint64(writer, block.pointers);
+        writer.write(block.indices.data(), nnz * sizeof(uint16_t));
+        writer.pad();
+        writer.write(block.values(), nnz * block.value_bytes);
+        writer.pad();
+    }
+
+    writer.close();
+}
+
+/**
+ * @param path Path to a snapshot created by `save_numeric_matrix()`.
+ *
+ * @return A `NumericMatrix` containing the layered sparse matrix.
+ */
+NumericMatrix load_numeric_matrix_from_file(std::string path) {
+    snapshot::FileSource source(path);
+    return snapshot::load(source);
+}
+
+/**
+ * @param buffer Offset to an array of `uint8_t`s containing the contents of a snapshot created by `save_numeric_matrix()`.
+ * @param size Length of the array in `buffer`.
+ *
+ * @return A `NumericMatrix` containing the layered sparse matrix.
+ */
+NumericMatrix load_numeric_matrix_from_buffer(uintptr_t buffer, size_t size) {
+    snapshot::BufferSource source(reinterpret_cast<const unsigned char*>(buffer), size);
+    return snapshot::load(source);
+}
+
+/**
+ * @cond
+ */
+EMSCRIPTEN_BINDINGS(save_numeric_matrix) {
+    emscripten::function("save_numeric_matrix", &js_bind<&save_numeric_matrix>::fun);
+
+    emscripten::function("load_numeric_matrix_from_file", &js_bind<&load_numeric_matrix_from_file>::fun);
+
+    emscripten::function("load_numeric_matrix_from_buffer", &js_bind<&load_numeric_matrix_from_buffer>::fun);
+}
+/**
+ * @endcond
+ */
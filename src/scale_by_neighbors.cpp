@@ -40,7 +40,9 @@ void scale_by_neighbors_internal(
     return;
 }
 
-void scale_by_neighbors_indices(int ncells, int nembed, uintptr_t embeddings, uintptr_t indices, uintptr_t combined, int num_neighbors, bool use_weights, uintptr_t weights) {
+void scale_by_neighbors_indices(int ncells, int nembed, uintptr_t embeddings, uintptr_t indices, uintptr_t combined, int num_neighbors, bool use_weights, uintptr_t weights, int nthreads) {
+    ScopedExecutionContext scope{ ExecutionContext(nthreads) };
+
     auto index_ptrs = convert_array_of_offsets<const NeighborIndex*>(nembed, indices);
 
     std::vector<const knncolle::Base<>*> actual_ptrs;
@@ -55,7 +57,9 @@ void scale_by_neighbors_indices(int ncells, int nembed, uintptr_t embeddings, ui
     return;
 }
 
-void scale_by_neighbors_matrices(int ncells, int nembed, uintptr_t ndims, uintptr_t embeddings, uintptr_t combined, int num_neighbors, bool use_weights, uintptr_t weights, bool approximate) {
+void scale_by_neighbors_matrices(int ncells, int nembed, uintptr_t ndims, uintptr_t embeddings, uintptr_t combined, int num_neighbors, bool use_weights, uintptr_t weights, bool approximate, int nthreads) {
+    ScopedExecutionContext scope{ ExecutionContext(nthreads) };
+
     auto ndim_ptrs = reinterpret_cast<const int*>(ndims);
     auto embed_ptrs = convert_array_of_offsets<const double*>(nembed, embeddings);
 
@@ -83,7 +87,7 @@ void scale_by_neighbors_matrices(int ncells, int nembed, uintptr_t ndims, uintpt
 }
 
 EMSCRIPTEN_BINDINGS(scale_by_neighbors) {
-    emscripten::function("scale_by_neighbors_matrices", &scale_by_neighbors_matrices);
+    emscripten::function("scale_by_neighbors_matrices", &js_bind<&scale_by_neighbors_matrices>::fun);
 
-    emscripten::function("scale_by_neighbors_indices", &scale_by_neighbors_indices);
+    emscripten::function("scale_by_neighbors_indices", &js_bind<&scale_by_neighbors_indices>::fun);
 }
@@ -200,10 +200,14 @@ std::vector<std::vector<Stat*> > vector_to_pointers2(std::vector<std::vector<std
  * @param[in] blocks If `use_blocks = true`, offset to an array of `int32_t`s with `ncells` elements, containing the block assignment for each cell.
  * Block IDs should be consecutive and 0-based.
  * If `use_blocks = false`, this value is ignored.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
  *
  * @return A `ScoreMarkers_Results` containing summary statistics from comparisons between groups of cells.
  */
-ScoreMarkers_Results score_markers(const NumericMatrix& mat, uintptr_t groups, bool use_blocks, uintptr_t blocks) {
+ScoreMarkers_Results score_markers(const NumericMatrix& mat, uintptr_t groups, bool use_blocks, uintptr_t blocks, int nthreads) {
+    ScopedExecutionContext scope(mat.execution_context(nthreads));
+
     const int32_t* gptr = reinterpret_cast<const int32_t*>(groups);
     const int32_t* bptr = NULL;
     if (use_blocks) {
@@ -222,17 +226,17 @@ ScoreMarkers_Results score_markers(const NumericMatrix& mat, uintptr_t groups, b
  * @cond 
  */
 EMSCRIPTEN_BINDINGS(score_markers) {
-    emscripten::function("score_markers", &score_markers);
+    emscripten::function("score_markers", &js_bind<&score_markers>::fun);
 
     emscripten::class_<ScoreMarkers_Results>("ScoreMarkers_Results")
-        .function("means", &ScoreMarkers_Results::means)
-        .function("detected", &ScoreMarkers_Results::detected)
-        .function("cohen", &ScoreMarkers_Results::cohen)
-        .function("auc", &ScoreMarkers_Results::auc)
-        .function("lfc", &ScoreMarkers_Results::lfc)
-        .function("delta_detected", &ScoreMarkers_Results::delta_detected)
-        .function("num_groups", &ScoreMarkers_Results::num_groups)
-        .function("num_blocks", &ScoreMarkers_Results::num_blocks)
+        .function("means", &js_bind<&ScoreMarkers_Results::means>::fun)
+        .function("detected", &js_bind<&ScoreMarkers_Results::detected>::fun)
+        .function("cohen", &js_bind<&ScoreMarkers_Results::cohen>::fun)
+        .function("auc", &js_bind<&ScoreMarkers_Results::auc>::fun)
+        .function("lfc", &js_bind<&ScoreMarkers_Results::lfc>::fun)
+        .function("delta_detected", &js_bind<&ScoreMarkers_Results::delta_detected>::fun)
+        .function("num_groups", &js_bind<&ScoreMarkers_Results::num_groups>::fun)
+        .function("num_blocks", &js_bind<&ScoreMarkers_Results::num_blocks>::fun)
         ;
 }
 /**
@@ -35,12 +35,7 @@ NumericMatrix column_subset(const NumericMatrix& matrix, uintptr_t offset, size_
     auto offset_ptr = reinterpret_cast<const int*>(offset);
     check_limit<false>(offset_ptr, length, matrix.ncol());
 
-    auto ptr = tatami::make_DelayedSubset<1>(matrix.ptr, std::vector<int>(offset_ptr, offset_ptr + length));
-    if (matrix.is_reorganized) {
-        return NumericMatrix(std::move(ptr), matrix.row_ids);
-    } else {
-        return NumericMatrix(std::move(ptr));
-    }
+    return matrix.derive(tatami::make_DelayedSubset<1>(matrix.ptr, std::vector<int>(offset_ptr, offset_ptr + length)));
 }
 
 /** 
@@ -64,16 +59,18 @@ NumericMatrix row_subset(const NumericMatrix& matrix, uintptr_t offset, size_t l
         std::copy(offset_ptr, offset_ptr + length, remaining.begin());
     }
 
-    return NumericMatrix(tatami::make_DelayedSubset<0>(matrix.ptr, std::vector<int>(offset_ptr, offset_ptr + length)), std::move(remaining));
+    NumericMatrix output(tatami::make_DelayedSubset<0>(matrix.ptr, std::vector<int>(offset_ptr, offset_ptr + length)), std::move(remaining));
+    output.is_file_backed = matrix.is_file_backed;
+    return output;
 }
 
 /**
  * @cond
  */
 EMSCRIPTEN_BINDINGS(column_subset) {
-    emscripten::function("column_subset", &column_subset);
+    emscripten::function("column_subset", &js_bind<&column_subset>::fun);
 
-    emscripten::function("row_subset", &row_subset);
+    emscripten::function("row_subset", &js_bind<&row_subset>::fun);
 }
 /**
  * @endcond
@@ -5,11 +5,12 @@
 #include <cstdint>
 #include <cmath>
 #include <iostream>
+#include <type_traits>
 
 template<typename T>
 std::vector<T> convert_array_of_offsets(size_t n, uintptr_t x) {
     std::vector<T> output(n);
-    auto ptr = reinterpret_cast<const uint64_t*>(x); // using 64-bit offsets for future-proofing.
+    auto ptr = reinterpret_cast<const uint64_t*>(x); // always 64-bit offsets, so the same JS code works for wasm32 and wasm64 builds.
     for (size_t i = 0; i < n; ++i) {
         uintptr_t current = ptr[i];
         output[i] = reinterpret_cast<T>(current);
@@ -17,6 +18,62 @@ std::vector<T> convert_array_of_offsets(size_t n, uintptr_t x) {
     return output;
 }
 
+/**
+ * @cond
+ */
+// embind represents 64-bit integers as BigInts, so any size_t or uintptr_t in
+// a binding would need BigInts on the JS side of a wasm64 build. Instead, the
+// bindings receive and return offsets and lengths as doubles, which are exact
+// up to 2^53 and behave like the usual Numbers in both wasm32 and wasm64.
+static_assert(std::is_same<size_t, uintptr_t>::value, "size_t and uintptr_t should be the same type");
+
+template<typename T>
+struct js_type {
+    typedef T type;
+};
+
+template<>
+struct js_type<uintptr_t> {
+    typedef double type;
+};
+
+template<>
+struct js_type<intptr_t> {
+    typedef double type;
+};
+
+template<auto F, typename Signature = decltype(F)>
+struct js_bind;
+
+template<auto F, typename Output, typename ... Args>
+struct js_bind<F, Output (*)(Args...)> {
+    static typename js_type<Output>::type fun(typename js_type<Args>::type ... args) {
+        return F(static_cast<Args>(args)...);
+    }
+};
+
+template<auto F, typename Output, class Class, typename ... Args>
+struct js_bind<F, Output (Class::*)(Args...)> {
+    static typename js_type<Output>::type fun(Class& self, typename js_type<Args>::type ... args) {
+        return (self.*F)(static_cast<Args>(args)...);
+    }
+};
+
+template<auto F, typename Output, class Class, typename ... Args>
+struct js_bind<F, Output (Class::*)(Args...) const> {
+    static typename js_type<Output>::type fun(const Class& self, typename js_type<Args>::type ... args) {
+        return (self.*F)(static_cast<Args>(args)...);
+    }
+};
+
+template<class Class, typename ... Args>
+Class* js_construct(typename js_type<Args>::type ... args) {
+    return new Class(static_cast<Args>(args)...);
+}
+/**
+ * @endcond
+ */
+
 inline std::vector<size_t> permutation_to_indices(const std::vector<size_t>& permutation) { 
     std::vector<size_t> ids(permutation.size());
     for (size_t i = 0; i < ids.size(); ++i) {
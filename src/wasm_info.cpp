@@ -0,0 +1,22 @@
+#include <emscripten/bind.h>
+#include "utils.h"
+#include <cstddef>
+
+/**
+ * Get the size of a pointer in the Wasm binary.
+ *
+ * @return 4 for the usual 32-bit builds, or 8 for builds with 64-bit memory.
+ */
+int pointer_size() {
+    return sizeof(void*);
+}
+
+/**
+ * @cond
+ */
+EMSCRIPTEN_BINDINGS(wasm_info) {
+    emscripten::function("pointer_size", &js_bind<&pointer_size>::fun);
+}
+/**
+ * @endcond
+ */
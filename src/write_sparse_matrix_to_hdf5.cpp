@@ -0,0 +1,280 @@
+#include <emscripten.h>
+#include <emscripten/bind.h>
+
+#include "utils.h"
+#include "NumericMatrix.h"
+#include "H5Cpp.h"
+#include "zlib.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <cstdint>
+#include <cmath>
+
+/**
+ * @file write_sparse_matrix_to_hdf5.cpp
+ *
+ * @brief Write a `NumericMatrix` to a HDF5 file in a compressed sparse format.
+ */
+
+/**
+ * @cond
+ */
+namespace sparse_writer {
+
+/*
+ * A chunk of the 'data' and 'indices' datasets, after compression.
+ */
+struct CompressedChunk {
+    hsize_t offset;
+    std::vector<unsigned char> data, indices;
+};
+
+inline void compress_chunk(const void* src, size_t nbytes, int level, std::vector<unsigned char>& output) {
+    uLongf dest_len = compressBound(nbytes);
+    output.resize(dest_len);
+    if (compress2(output.data(), &dest_len, reinterpret_cast<const Bytef*>(src), nbytes, level) != Z_OK) {
+        throw std::runtime_error("failed to compress a chunk");
+    }
+    output.resize(dest_len);
+}
+
+inline void write_chunk(const H5::DataSet& dhandle, hsize_t offset, const std::vector<unsigned char>& bytes) {
+    if (H5Dwrite_chunk(dhandle.getId(), H5P_DEFAULT, 0, &offset, bytes.size(), bytes.data()) < 0) {
+        throw std::runtime_error("failed to write a chunk to the HDF5 file");
+    }
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @param mat A `NumericMatrix`, possibly containing delayed operations.
+ * @param path Path to an existing HDF5 file.
+ * @param name Name of the group to create inside the file.
+ * @param format Format of the group, either `"10x"` or `"h5ad"`.
+ * For `"10x"`, the dimensions are stored in a `shape` dataset; for `"h5ad"`, they are stored in the `shape` attribute with `encoding-type` and `encoding-version` attributes.
+ * In both cases, the matrix is stored with features in the rows and cells in the columns, as expected by `read_hdf5_matrix()`.
+ * @param deflate_level DEFLATE compression level for the `data` and `indices` datasets, from 0 to 9.
+ * @param chunk_size Number of elements in each chunk of the `data` and `indices` datasets.
+ * @param nthreads Number of threads to use.
+ * If zero, all threads in the pool are used.
+ *
+ * @return A group is created at `name` containing the `data`, `indices` and `indptr` datasets for a compressed sparse column representation of `mat`.
+ * Values are stored as 32-bit integers if they are all integral and within range, otherwise as doubles.
+ *
+ * If the rows of `mat` have been reorganized, they are written in increasing order of their identities.
+ * For a layered matrix loaded from a file, this restores the original order of the rows.
+ *
+ * Columns are extracted and compressed in chunks on the worker pool, while the compressed chunks from the previous batch are written on the calling thread.
+ * Only the writes to the HDF5 file are serialized.
+ */
+void write_sparse_matrix_to_hdf5(const NumericMatrix& mat, std::string path, std::string name, std::string format, int deflate_level, int chunk_size, int nthreads) {
+    if (format != "10x" && format != "h5ad") {
+        throw std::runtime_error("unknown format '" + format + "' for writing a sparse matrix");
+    }
+    if (deflate_level < 0 || deflate_level > 9) {
+        throw std::runtime_error("'deflate_level' should be an integer from 0 to 9");
+    }
+    if (chunk_size <= 0) {
+        throw std::runtime_error("'chunk_size' should be positive");
+    }
+
+    ScopedExecutionContext scope{ mat.execution_context(nthreads) };
+    const auto& ptr = mat.ptr;
+    size_t nrow = ptr->nrow(), ncol = ptr->ncol();
+
+    // Ranking the rows by their identities, so that reorganized rows are
+    // written in their original order.
+    std::vector<int> rank;
+    if (mat.is_reorganized) {
+        std::vector<int> order(nrow);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](int l, int r) -> bool { return mat.row_ids[l] < mat.row_ids[r]; });
+        rank.resize(nrow);
+        for (size_t r = 0; r < nrow; ++r) {
+            rank[order[r]] = r;
+        }
+    }
+
+    // Extracts the non-zero elements of a column, sorted by their output row index.
+    struct Extractor {
+        Extractor(const NumericMatrix& mat, const std::vector<int>& rank) : mat(mat), rank(rank), work(mat.ptr->new_workspace(false)), vbuffer(mat.ptr->nrow()), ibuffer(mat.ptr->nrow()) {}
+
+        const NumericMatrix& mat;
+        const std::vector<int>& rank;
+        std::shared_ptr<tatami::Workspace> work;
+        std::vector<double> vbuffer;
+        std::vector<int> ibuffer;
+        std::vector<std::pair<int, double> > nonzero;
+
+        const std::vector<std::pair<int, double> >& extract(size_t c) {
+            auto range = mat.ptr->sparse_column(c, vbuffer.data(), ibuffer.data(), work.get());
+            nonzero.clear();
+            for (int i = 0; i < range.number; ++i) {
+                if (range.value[i]) {
+                    nonzero.emplace_back(rank.empty() ? range.index[i] : rank[range.index[i]], range.value[i]);
+                }
+            }
+            if (!rank.empty()) {
+                std::sort(nonzero.begin(), nonzero.end());
+            }
+            return nonzero;
+        }
+    };
+
+    // First pass to count the non-zero elements in each column, and to check
+    // whether the values can be stored as integers.
+    std::vector<uint64_t> indptr(ncol + 1);
+    std::vector<uint8_t> non_integer(ncol);
+    run_parallel(ncol, [&](int first, int last) -> void {
+        Extractor ext(mat, rank);
+        for (int c = first; c < last; ++c) {
+            const auto& nonzero = ext.extract(c);
+            indptr[c + 1] = nonzero.size();
+            for (const auto& x : nonzero) {
+                if (x.second != std::floor(x.second) || std::abs(x.second) > INT32_MAX) {
+                    non_integer[c] = 1;
+                    break;
+                }
+            }
+        }
+    });
+
+    for (size_t c = 0; c < ncol; ++c) {
+        indptr[c + 1] += indptr[c];
+    }
+    const size_t nnz = indptr.back();
+    const bool as_integer = std::find(non_integer.begin(), non_integer.end(), 1) == non_integer.end();
+    const size_t value_bytes = (as_integer ? sizeof(int32_t) : sizeof(double));
+
+    try {
+        H5::H5File handle(path, H5F_ACC_RDWR);
+        auto ghandle = handle.createGroup(name);
+
+        // Creating the datasets, with chunking and compression if there is anything to store.
+        hsize_t nnz_dim = nnz;
+        H5::DataSpace nnz_space(1, &nnz_dim);
+        H5::DSetCreatPropList plist;
+        hsize_t chunk_dim = std::min(static_cast<hsize_t>(chunk_size), std::max(nnz_dim, static_cast<hsize_t>(1)));
+        if (nnz) {
+            plist.setChunk(1, &chunk_dim);
+            plist.setDeflate(deflate_level);
+        }
+
+        auto data_type = (as_integer ? H5::PredType::NATIVE_INT32 : H5::PredType::NATIVE_DOUBLE);
+        auto dhandle = ghandle.createDataSet("data", data_type, nnz_space, plist);
+        auto ihandle = ghandle.createDataSet("indices", H5::PredType::NATIVE_INT32, nnz_space, plist);
+
+        hsize_t ptr_dim = ncol + 1;
+        auto phandle = ghandle.createDataSet("indptr", H5::PredType::NATIVE_UINT64, H5::DataSpace(1, &ptr_dim));
+        phandle.write(indptr.data(), H5::PredType::NATIVE_UINT64);
+
+        hsize_t shape_dim = 2;
+        if (format == "10x") {
+            int32_t shape[2];
+            shape[0] = nrow;
+            shape[1] = ncol;
+            auto shandle = ghandle.createDataSet("shape", H5::PredType::NATIVE_INT32, H5::DataSpace(1, &shape_dim));
+            shandle.write(shape, H5::PredType::NATIVE_INT32);
+        } else {
+            // H5AD stores cells in the rows, so our CSC matrix is their CSR matrix.
+            // The shape is stored as 64-bit integers, consistent with anndata.
+            int64_t shape[2];
+            shape[0] = ncol;
+            shape[1] = nrow;
+            auto shandle = ghandle.createAttribute("shape", H5::PredType::NATIVE_INT64, H5::DataSpace(1, &shape_dim));
+            shandle.write(H5::PredType::NATIVE_INT64, shape);
+
+            H5::StrType stype(0, H5T_VARIABLE);
+            auto ehandle = ghandle.createAttribute("encoding-type", stype, H5::DataSpace(H5S_SCALAR));
+            ehandle.write(stype, H5std_string("csr_matrix"));
+            auto vhandle = ghandle.createAttribute("encoding-version", stype, H5::DataSpace(H5S_SCALAR));
+            vhandle.write(stype, H5std_string("0.1.0"));
+        }
+
+        if (nnz == 0) {
+            return;
+        }
+
+        // Compressing batches of chunks in parallel, while the previous batch is written.
+        const size_t chunk_len = chunk_dim;
+        const size_t nchunks = (nnz + chunk_len - 1) / chunk_len;
+        const size_t batch_size = std::max(1, current_num_threads()) * 4;
+        std::vector<sparse_writer::CompressedChunk> current, previous;
+
+        auto fill = [&](sparse_writer::CompressedChunk& output, size_t chunk) -> void {
+            size_t start = chunk * chunk_len, end = std::min(start + chunk_len, nnz);
+            output.offset = start;
+
+            // Chunks are always stored at full size, so the last chunk is zero-padded.
+            std::vector<int32_t> indices(chunk_len);
+            std::vector<int32_t> ivalues(as_integer ? chunk_len : 0);
+            std::vector<double> dvalues(as_integer ? 0 : chunk_len);
+
+            Extractor ext(mat, rank);
+            size_t c = std::upper_bound(indptr.begin(), indptr.end(), start) - indptr.begin() - 1;
+            for (; c < ncol && indptr[c] < end; ++c) {
+                if (indptr[c] == indptr[c + 1]) {
+                    continue;
+                }
+
+                const auto& nonzero = ext.extract(c);
+                size_t first = std::max(start, static_cast<size_t>(indptr[c])), last = std::min(end, static_cast<size_t>(indptr[c + 1]));
+                for (size_t i = first; i < last; ++i) {
+                    const auto& x = nonzero[i - indptr[c]];
+                    indices[i - start] = x.first;
+                    if (as_integer) {
+                        ivalues[i - start] = x.second;
+                    } else {
+                        dvalues[i - start] = x.second;
+                    }
+                }
+            }
+
+            sparse_writer::compress_chunk(indices.data(), chunk_len * sizeof(int32_t), deflate_level, output.indices);
+            if (as_integer) {
+                sparse_writer::compress_chunk(ivalues.data(), chunk_len * value_bytes, deflate_level, output.data);
+            } else {
+                sparse_writer::compress_chunk(dvalues.data(), chunk_len * value_bytes, deflate_level, output.data);
+            }
+        };
+
+        auto write = [&]() -> void {
+            for (const auto& chunk : previous) {
+                sparse_writer::write_chunk(dhandle, chunk.offset, chunk.data);
+                sparse_writer::write_chunk(ihandle, chunk.offset, chunk.indices);
+            }
+        };
+
+        for (size_t batch_start = 0; batch_start < nchunks; batch_start += batch_size) {
+            size_t batch_end = std::min(batch_start + batch_size, nchunks);
+            current.resize(batch_end - batch_start);
+            run_parallel_with_io(write, current.size(), [&](int first, int last) -> void {
+                for (int i = first; i < last; ++i) {
+                    fill(current[i], batch_start + i);
+                }
+            });
+            current.swap(previous);
+        }
+        write();
+
+    } catch (H5::Exception& e) {
+        throw std::runtime_error(e.getCDetailMsg());
+    }
+}
+
+/**
+ * @cond
+ */
+EMSCRIPTEN_BINDINGS(write_sparse_matrix_to_hdf5) {
+    emscripten::function("write_sparse_matrix_to_hdf5", &js_bind<&write_sparse_matrix_to_hdf5>::fun);
+}
+/**
+ * @endcond
+ */
@@ -73,3 +73,20 @@ test("clusterKmeans works with other options", () => {
     var res2 = scran.clusterKmeans(pcs, k, { numberOfCells: ncells, numberOfDims: ndim, initMethod: "random" });
     checkClusterConsistency(res2, ncells, k);
 });
+
+test("clusterKmeans gives the same results with different numbers of threads", () => {
+    var ndim = 5;
+    var ncells = 500;
+    var pcs = simulate.simulatePCs(ndim, ncells);
+
+    var k = 5;
+    var res1 = scran.clusterKmeans(pcs, k, { numberOfCells: ncells, numberOfDims: ndim, numberOfThreads: 1 });
+    var res2 = scran.clusterKmeans(pcs, k, { numberOfCells: ncells, numberOfDims: ndim });
+    expect(compare.equalArrays(res1.clusters(), res2.clusters())).toBe(true);
+    expect(compare.equalFloatArrays(res1.withinClusterSumSquares(), res2.withinClusterSumSquares())).toBe(true);
+
+    // Cleaning up.
+    res1.free();
+    res2.free();
+    pcs.free();
+});
@@ -64,3 +64,74 @@ test("clusterSNNGraph works with other clustering methods", () => {
     clusters.free();
     clusters2.free();
 })
+
+test("buildSNNGraph exposes the graph in CSR format", () => {
+    var ndim = 5;
+    var ncells = 100;
+    var index = simulate.simulateIndex(ndim, ncells);
+    var graph = scran.buildSNNGraph(index, { neighbors: 5 });
+
+    expect(graph.numberOfCells()).toBe(ncells);
+    var offsets = graph.offsets();
+    var targets = graph.targets();
+    var weights = graph.weights();
+
+    expect(offsets.length).toBe(ncells + 1);
+    expect(offsets[ncells]).toBe(graph.numberOfEdges());
+    expect(targets.length).toBe(graph.numberOfEdges());
+    expect(weights.length).toBe(graph.numberOfEdges());
+
+    for (var i = 0; i < ncells; i++) {
+        for (var e = offsets[i]; e < offsets[i + 1]; e++) {
+            expect(targets[e] < i).toBe(true);
+            expect(weights[e] > 0).toBe(true);
+        }
+    }
+
+    // Views work as expected.
+    var view = graph.weights({ copy: "view" });
+    expect(compare.equalArrays(view.array(), weights)).toBe(true);
+
+    index.free();
+    graph.free();
+});
+
+test("buildSNNGraph gives the same graph from an index or from neighbor search results", () => {
+    var ndim = 5;
+    var ncells = 200;
+    var index = simulate.simulateIndex(ndim, ncells);
+
+    var k = 8;
+    var res = scran.findNearestNeighbors(index, k);
+    var graph1 = scran.buildSNNGraph(res, { scheme: "jaccard" });
+    var graph2 = scran.buildSNNGraph(index, { neighbors: k, scheme: "jaccard" });
+
+    expect(compare.equalArrays(graph1.offsets(), graph2.offsets())).toBe(true);
+    expect(compare.equalArrays(graph1.targets(), graph2.targets())).toBe(true);
+    expect(compare.equalArrays(graph1.weights(), graph2.weights())).toBe(true);
+
+    index.free();
+    res.free();
+    graph1.free();
+    graph2.free();
+});
+
+test("buildSNNGraph gives the same results with different numbers of threads", () => {
+    var ndim = 5;
+    var ncells = 500;
+    var index = simulate.simulateIndex(ndim, ncells);
+
+    var k = 10;
+    var graph1 = scran.buildSNNGraph(index, { neighbors: k, numberOfThreads: 1 });
+    var graph2 = scran.buildSNNGraph(index, { neighbors: k });
+    var clusters1 = scran.clusterSNNGraph(graph1);
+    var clusters2 = scran.clusterSNNGraph(graph2);
+    expect(compare.equalArrays(clusters1.membership(), clusters2.membership())).toBe(true);
+
+    // Cleaning up.
+    index.free();
+    graph1.free();
+    graph2.free();
+    clusters1.free();
+    clusters2.free();
+});
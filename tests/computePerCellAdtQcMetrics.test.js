@@ -46,3 +46,20 @@ test("per-cell QC ADT-based metrics can be mocked up", () => {
 
     qc.free();
 });
+
+test("per-cell ADT-based QC metrics are the same with different numbers of threads", () => {
+    var ngenes = 100;
+    var ncells = 200;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var subs = simulate.simulateSubsets(ngenes, 1);
+
+    var qc1 = scran.computePerCellAdtQcMetrics(mat, subs, { numberOfThreads: 1 });
+    var qc2 = scran.computePerCellAdtQcMetrics(mat, subs);
+    expect(compare.equalArrays(qc1.sums(), qc2.sums())).toBe(true);
+    expect(compare.equalArrays(qc1.detected(), qc2.detected())).toBe(true);
+    expect(compare.equalArrays(qc1.subsetTotals(0), qc2.subsetTotals(0))).toBe(true);
+
+    mat.free();
+    qc1.free();
+    qc2.free();
+});
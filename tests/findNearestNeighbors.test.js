@@ -81,6 +81,12 @@ test("neighbor search works with serialization", () => {
     expect(compare.equalArrays(dump.indices, dump3.indices)).toBe(true);
     expect(compare.equalArrays(dump.distances, dump3.distances)).toBe(true);
 
+    // Using views.
+    let dump4 = res.serialize({ copy: "view" });
+    expect(compare.equalArrays(dump.runs, dump4.runs)).toBe(true);
+    expect(compare.equalArrays(dump.indices, dump4.indices.array())).toBe(true);
+    expect(compare.equalArrays(dump.distances, dump4.distances.array())).toBe(true);
+
     // Cleaning up.
     buffer.free();
     index.free();
@@ -92,3 +98,29 @@ test("neighbor search works with serialization", () => {
     buf_indices.free();
     buf_distances.free();
 });
+
+test("neighbor search gives the same results with different numbers of threads", () => {
+    var ndim = 5;
+    var ncells = 500;
+    var buffer = scran.createFloat64WasmArray(ndim * ncells);
+    var arr = buffer.array();
+    arr.forEach((x, i) => arr[i] = Math.random());
+
+    var index = scran.buildNeighborSearchIndex(buffer, { numberOfDims: ndim, numberOfCells: ncells, approximate: false });
+    var k = 10;
+    var res1 = scran.findNearestNeighbors(index, k, { numberOfThreads: 1 });
+    var res2 = scran.findNearestNeighbors(index, k);
+
+    var first = res1.serialize();
+    var second = res2.serialize();
+    expect(compare.equalArrays(first.indices, second.indices)).toBe(true);
+    expect(compare.equalArrays(first.distances, second.distances)).toBe(true);
+
+    expect(() => scran.findNearestNeighbors(index, k, { numberOfThreads: 0 })).toThrow("positive integer");
+
+    // Mopping up.
+    buffer.free();
+    index.free();
+    res1.free();
+    res2.free();
+});
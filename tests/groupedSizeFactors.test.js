@@ -57,3 +57,21 @@ test("Size factor calculation works with buffering", () => {
     thing.free();
     groups.free();
 })
+
+test("Size factor calculation gives the same results with different numbers of threads", () => {
+    var ngenes = 1000;
+    var ncells = 100;
+    var mat = simulate.simulateMatrix(ngenes, ncells, 1);
+
+    var groups = new Uint32Array(ncells);
+    groups.forEach((x, i) => groups[i] = i % 20);
+
+    var norm1 = scran.groupedSizeFactors(mat, groups, { numberOfThreads: 1 });
+    var norm2 = scran.groupedSizeFactors(mat, groups);
+    expect(compare.equalFloatArrays(norm1.array(), norm2.array())).toBe(true);
+
+    // Cleaning up.
+    mat.free();
+    norm1.free();
+    norm2.free();
+});
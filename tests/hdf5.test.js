@@ -126,6 +126,42 @@ test("HDF5 dataset loading works as expected", () => {
     expect(compare.equalArrays(z2.contents, z)).toBe(true);
 });
 
+test("HDF5 loading works from in-memory files", () => {
+    const path = dir + "/test.buffer.h5";
+    purge(path)
+
+    let x = new Float64Array(100).map(() => Math.random());
+    let z = ["Aaron", "Jayaram", "Donald"];
+
+    let f = new hdf5.File(path, "w");
+    f.create_group("foo");
+    f.get("foo").create_dataset("stuff", x, [20, 5]);
+    f.get("foo").create_dataset("whee", z, [3]);
+    f.close();
+
+    let contents = fs.readFileSync(path);
+    let buffer = scran.createUint8WasmArray(contents.length);
+    buffer.array().set(contents);
+
+    let n = scran.extractHDF5ObjectNames(buffer);
+    expect(n["foo"]["stuff"]).toBe("float dataset");
+    expect(n["foo"]["whee"]).toBe("string dataset");
+
+    let x2 = scran.loadHDF5Dataset(buffer, "foo/stuff");
+    expect(compare.equalArrays(x2.dimensions, [20, 5])).toBe(true);
+    expect(compare.equalArrays(x2.contents, x)).toBe(true);
+
+    let handle = new scran.H5File(buffer);
+    let z2 = handle.open("foo").open("whee", { load: true });
+    expect(compare.equalArrays(z2.values, z)).toBe(true);
+
+    // Files in memory are read-only.
+    expect(() => handle.createGroup("bar")).toThrow("loaded into memory");
+    expect(() => scran.extractHDF5ObjectNames(new Uint8Array(contents))).toThrow("Uint8WasmArray");
+
+    buffer.free();
+})
+
 test("HDF5 creation works as expected", () => {
     const path = dir + "/test.write.h5";
     purge(path)
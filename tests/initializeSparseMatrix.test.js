@@ -183,3 +183,133 @@ test("initialization from Gzipped MatrixMarket works correctly with Gzip", () =>
     mat2.free();
     buffer.free();
 })
+
+test("streaming initialization from MatrixMarket works correctly", async () => {
+    var content = "%%MatrixMarket matrix coordinate integer general\n% comment\n11 5 7\n1 2 5\n10 3 2\n7 4 22\n5 1 12\n6 3 2\n1 5 8\n2 2 1000";
+    var ref = scran.initializeSparseMatrixFromMatrixMarket(new TextEncoder().encode(content));
+
+    let check = mat => {
+        expect(mat.numberOfRows()).toBe(11);
+        expect(mat.numberOfColumns()).toBe(5);
+        let ids = mat.identities();
+        let ref_ids = ref.identities();
+        for (var r = 0; r < 11; r++) {
+            expect(compare.equalArrays(mat.row(r), ref.row(ref_ids.indexOf(ids[r])))).toBe(true);
+        }
+    };
+
+    // Splitting into awkward chunks, for both raw and Gzipped content.
+    for (const raw of [ new TextEncoder().encode(content), pako.gzip(content) ]) {
+        let reader = scran.createMatrixMarketReader();
+        for (var i = 0; i < raw.length; i += 7) {
+            reader.add(raw.slice(i, i + 7));
+        }
+        let mat = reader.finish();
+        check(mat);
+        mat.free();
+    }
+
+    // Works with streams.
+    const path = dir + "/test.stream.mtx.gz";
+    fs.writeFileSync(path, pako.gzip(content));
+    let streamed = await scran.initializeSparseMatrixFromMatrixMarketStream(fs.createReadStream(path, { highWaterMark: 10 }));
+    check(streamed);
+
+    // Fails with invalid content.
+    let reader = scran.createMatrixMarketReader({ compressed: false });
+    expect(() => reader.add(new TextEncoder().encode("11 5 1\n1 1 2.5\n"))).toThrow("invalid line");
+    reader.free();
+    expect(() => reader.add(new Uint8Array(1))).toThrow("finish");
+
+    ref.free();
+    streamed.free();
+})
+
+test("initialization from large MatrixMarket files is consistent across threads", () => {
+    // Enough lines to be split across multiple threads, with values that need different types.
+    let NR = 2000, NC = 100;
+    let lines = [];
+    for (var c = 1; c <= NC; c++) {
+        for (var r = c % 2 + 1; r <= NR; r += 2) {
+            lines.push(String(r) + " " + String(c) + " " + String((r * c) % (r < 100 ? 100000 : 100) + 1));
+        }
+    }
+    let content = "%%MatrixMarket matrix coordinate integer general\n" + String(NR) + " " + String(NC) + " " + String(lines.length) + "\n" + lines.join("\n") + "\n";
+    let raw = new TextEncoder().encode(content);
+
+    let mat1 = scran.initializeSparseMatrixFromMatrixMarket(raw, { numberOfThreads: 1 });
+    let mat2 = scran.initializeSparseMatrixFromMatrixMarket(raw, { numberOfThreads: 3 });
+    expect(mat1.numberOfRows()).toBe(NR);
+    expect(mat1.numberOfColumns()).toBe(NC);
+    expect(mat1.identities()).toEqual(mat2.identities());
+
+    let ids = mat1.identities();
+    for (var r = 0; r < NR; r += 97) {
+        let row = mat2.row(r);
+        expect(compare.equalArrays(mat1.row(r), row)).toBe(true);
+        let original = ids[r] + 1;
+        expect(row[0]).toBe(original % 2 == 1 ? 0 : original % (original < 100 ? 100000 : 100) + 1);
+    }
+
+    mat1.free();
+    mat2.free();
+})
+
+test("dense initialization works with narrow types and borrowing", () => {
+    var vals = [1, 5, 0, 0, 7, 0, 0, 10, 4, 2, 0, 0, 0, 5, 8];
+
+    var as_u8 = scran.initializeDenseMatrixFromDenseArray(3, 5, new Uint8Array(vals));
+    var as_f32 = scran.initializeDenseMatrixFromDenseArray(3, 5, new Float32Array(vals));
+    expect(compare.equalArrays(as_u8.column(2), [0, 10, 4])).toBe(true);
+    expect(compare.equalArrays(as_f32.row(1), [5, 7, 10, 0, 5])).toBe(true);
+
+    var buffer = scran.createFloat64WasmArray(15);
+    buffer.set(vals);
+    var borrowed = scran.initializeDenseMatrixFromDenseArray(3, 5, buffer, { borrow: true });
+    expect(compare.equalArrays(borrowed.column(4), [0, 5, 8])).toBe(true);
+
+    // Modifications to the buffer are reflected in the matrix.
+    buffer.array()[14] = 20;
+    expect(compare.equalArrays(borrowed.column(4), [0, 5, 20])).toBe(true);
+
+    expect(() => scran.initializeDenseMatrixFromDenseArray(3, 5, vals, { borrow: true })).toThrow("Float64WasmArray");
+
+    as_u8.free();
+    as_f32.free();
+    borrowed.free();
+    buffer.free();
+});
+
+test("initialization works with single-precision storage", () => {
+    var vals = scran.createFloat64WasmArray(15);
+    vals.set([1.5, 5, 2, 3, 7, 8, 9, 10.25, 4, 2, 1, 1, 3, 5, 8]);
+    var indices = scran.createInt32WasmArray(15);
+    indices.set([3, 5, 5, 0, 2, 9, 1, 2, 5, 5, 6, 8, 8, 6, 9]);
+    var indptrs = scran.createInt32WasmArray(11);
+    indptrs.set([0, 2, 3, 6, 9, 11, 11, 12, 12, 13, 15]);
+
+    var mat = scran.initializeSparseMatrixFromCompressedVectors(11, 10, vals, indices, indptrs, { layered: false });
+    var mat32 = scran.initializeSparseMatrixFromCompressedVectors(11, 10, vals, indices, indptrs, { layered: false, float32: true });
+    expect(mat.isReorganized()).toBe(false);
+    expect(mat32.isReorganized()).toBe(false);
+    expect(compare.equalArrays(mat.column(0), [0, 0, 0, 1.5, 0, 5, 0, 0, 0, 0, 0])).toBe(true);
+    expect(compare.equalArrays(mat32.column(0), mat.column(0))).toBe(true);
+    expect(compare.equalArrays(mat32.row(2), mat.row(2))).toBe(true);
+
+    // Downstream functions work as usual.
+    var norm = scran.logNormCounts(mat);
+    var norm32 = scran.logNormCounts(mat32);
+    expect(compare.equalFloatArrays(norm32.row(5), norm.row(5))).toBe(true);
+
+    var dense = scran.initializeDenseMatrixFromDenseArray(11, 10, new Float64Array(110).map((x, i) => i / 7), { float32: true });
+    expect(Math.abs(dense.column(9)[10] - 109 / 7)).toBeLessThan(1e-5);
+
+    vals.free();
+    indices.free();
+    indptrs.free();
+    mat.free();
+    mat32.free();
+    norm.free();
+    norm32.free();
+    dense.free();
+})
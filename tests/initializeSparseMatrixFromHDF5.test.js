@@ -106,6 +106,31 @@ test("initialization from HDF5 works correctly with 10X inputs", () => {
         ref[indices[j]] = data[j];
     }
     expect(compare.equalArrays(first_col, ref)).toBe(true);
+
+    // Reading in smaller blocks gives the same results.
+    let stats = {};
+    let stats_small = {};
+    var mat_big = scran.initializeSparseMatrixFromHDF5(path, "foobar", { statistics: stats });
+    var mat_small = scran.initializeSparseMatrixFromHDF5(path, "foobar", { blockSize: 20, chunkCacheSize: 0, statistics: stats_small });
+    expect(compare.equalArrays(mat_small.column(0), first_col)).toBe(true);
+    expect(compare.equalArrays(mat_small.row(5), mat.row(5))).toBe(true);
+
+    expect(stats.readCalls).toBe(3); // indptr, data and indices.
+    expect(stats.bytesRead).toBe(indptrs.byteLength + data.byteLength + indices.byteLength);
+    expect(stats_small.readCalls > stats.readCalls).toBe(true);
+    expect(stats_small.bytesRead >= stats.bytesRead).toBe(true);
+
+    // Same results without direct chunk reads, or with a single thread.
+    var mat_nodirect = scran.initializeSparseMatrixFromHDF5(path, "foobar", { directChunkRead: false });
+    var mat_single = scran.initializeSparseMatrixFromHDF5(path, "foobar", { numberOfThreads: 1 });
+    expect(compare.equalArrays(mat_nodirect.column(0), first_col)).toBe(true);
+    expect(compare.equalArrays(mat_single.column(0), first_col)).toBe(true);
+
+    mat.free();
+    mat_big.free();
+    mat_small.free();
+    mat_nodirect.free();
+    mat_single.free();
 })
 
 test("initialization from HDF5 works correctly with H5AD inputs", () => {
@@ -142,3 +167,280 @@ test("initialization from HDF5 works correctly with H5AD inputs", () => {
     expect(compare.equalArrays(first_row, ref)).toBe(true);
 })
 
+
+test("lazy initialization from HDF5 works correctly", () => {
+    const path = dir + "/test.sparse_lazy.h5";
+    purge(path);
+
+    let nr = 50;
+    let nc = 20;
+    const { data, indices, indptrs } = mock_sparse_matrix(nc, nr);
+
+    let f = new hdf5.File(path, "w");
+    f.create_group("foobar");
+    f.get("foobar").create_dataset("data", data);
+    f.get("foobar").create_dataset("indices", indices);
+    f.get("foobar").create_dataset("indptr", indptrs);
+    f.get("foobar").create_dataset("shape", [nr, nc], null, "<i");
+    f.close();
+
+    var ref = scran.initializeSparseMatrixFromHDF5(path, "foobar");
+    var lazy = scran.initializeSparseMatrixFromHDF5(path, "foobar", { lazy: true, cacheSize: 1000 });
+    expect(lazy.numberOfRows()).toBe(nr); 
+    expect(lazy.numberOfColumns()).toBe(nc);
+    expect(lazy.isReorganized()).toBe(false);
+    expect(lazy.isFileBacked()).toBe(true);
+    expect(ref.isFileBacked()).toBe(false);
+
+    // Same contents as the in-memory version.
+    var ids = ref.identities();
+    for (var r = 0; r < nr; r++) {
+        expect(compare.equalArrays(ref.row(r), lazy.row(ids[r]))).toBe(true);
+    }
+
+    // Computations give the same results.
+    var ref_qc = scran.computePerCellQCMetrics(ref, []);
+    var lazy_qc = scran.computePerCellQCMetrics(lazy, []);
+    expect(compare.equalArrays(ref_qc.sums(), lazy_qc.sums())).toBe(true);
+    expect(compare.equalArrays(ref_qc.detected(), lazy_qc.detected())).toBe(true);
+
+    var sub = scran.subsetColumns(lazy, [1, 3, 5]);
+    expect(sub.isFileBacked()).toBe(true);
+    expect(compare.equalArrays(sub.column(1), lazy.column(3))).toBe(true);
+
+    ref.free();
+    lazy.free();
+    ref_qc.free();
+    lazy_qc.free();
+    sub.free();
+})
+
+test("subsetted initialization from HDF5 works correctly", () => {
+    const path = dir + "/test.sparse_subset.h5";
+    purge(path);
+
+    let nr = 50;
+    let nc = 40;
+    const { data, indices, indptrs } = mock_sparse_matrix(nc, nr);
+
+    let f = new hdf5.File(path, "w");
+    f.create_group("foobar");
+    f.get("foobar").create_dataset("data", data);
+    f.get("foobar").create_dataset("indices", indices);
+    f.get("foobar").create_dataset("indptr", indptrs);
+    f.get("foobar").create_dataset("shape", [nr, nc], null, "<i");
+    f.create_dataset("dense", new Float64Array(nr * nc).map((x, i) => i % 13), [nc, nr]);
+    f.close();
+
+    var full = scran.initializeSparseMatrixFromHDF5(path, "foobar");
+    var full_ids = full.identities();
+    let subset_row = [1, 5, 3, 10, 20, 49];
+    let subset_col = [39, 0, 2, 2, 15];
+
+    let check = (sub, ref, ref_ids) => {
+        expect(sub.numberOfRows()).toBe(subset_row.length);
+        expect(sub.numberOfColumns()).toBe(subset_col.length);
+
+        let ids = sub.identities();
+        expect(compare.equalArrays(ids.slice().sort((a, b) => a - b), subset_row.slice().sort((a, b) => a - b))).toBe(true);
+
+        for (var r = 0; r < ids.length; r++) {
+            let expected_row = ref.row(ref_ids.indexOf(ids[r]));
+            expect(compare.equalArrays(sub.row(r), subset_col.map(c => expected_row[c]))).toBe(true);
+        }
+    };
+
+    for (const lazy of [false, true]) {
+        var sub = scran.initializeSparseMatrixFromHDF5(path, "foobar", { subsetRow: subset_row, subsetColumn: subset_col, lazy: lazy });
+        check(sub, full, full_ids);
+        sub.free();
+    }
+
+    var dense = scran.initializeSparseMatrixFromHDF5(path, "dense");
+    var dense_sub = scran.initializeSparseMatrixFromHDF5(path, "dense", { subsetRow: subset_row, subsetColumn: subset_col });
+    check(dense_sub, dense, Array.from(dense.identities()));
+
+    // Only subsetting one dimension.
+    var col_only = scran.initializeSparseMatrixFromHDF5(path, "foobar", { subsetColumn: subset_col });
+    expect(col_only.numberOfRows()).toBe(nr);
+    let col_only_ids = col_only.identities();
+    let col_only_first = col_only.column(1);
+    let full_first = full.column(0);
+    for (var r = 0; r < nr; r++) {
+        expect(col_only_first[r]).toBe(full_first[full_ids.indexOf(col_only_ids[r])]);
+    }
+
+    expect(() => scran.initializeSparseMatrixFromHDF5(path, "foobar", { subsetColumn: [nc] })).toThrow("column subset");
+
+    full.free();
+    dense.free();
+    dense_sub.free();
+    col_only.free();
+})
+
+test("initialization from in-memory HDF5 files works correctly", () => {
+    const path = dir + "/test.sparse_buffer.h5";
+    purge(path);
+
+    let nr = 50;
+    let nc = 30;
+    const { data, indices, indptrs } = mock_sparse_matrix(nc, nr);
+
+    let f = new hdf5.File(path, "w");
+    f.create_group("foobar");
+    f.get("foobar").create_dataset("data", data);
+    f.get("foobar").create_dataset("indices", indices);
+    f.get("foobar").create_dataset("indptr", indptrs);
+    f.get("foobar").create_dataset("shape", [nr, nc], null, "<i");
+    f.close();
+
+    var ref = scran.initializeSparseMatrixFromHDF5(path, "foobar");
+    let contents = fs.readFileSync(path);
+
+    // Reading directly from a Wasm buffer, or after copying from a JS array.
+    let buffer = scran.createUint8WasmArray(contents.length);
+    buffer.array().set(contents);
+    var mat = scran.initializeSparseMatrixFromHDF5(buffer, "foobar");
+    var mat2 = scran.initializeSparseMatrixFromHDF5(new Uint8Array(contents), "foobar", { subsetColumn: [1, 3, 5] });
+    buffer.free();
+
+    expect(mat.numberOfRows()).toBe(nr);
+    expect(mat.numberOfColumns()).toBe(nc);
+    expect(compare.equalArrays(mat.identities(), ref.identities())).toBe(true);
+    for (var c = 0; c < nc; c++) {
+        expect(compare.equalArrays(mat.column(c), ref.column(c))).toBe(true);
+    }
+    expect(compare.equalArrays(mat2.column(1), mat.column(3))).toBe(true);
+
+    expect(() => scran.initializeSparseMatrixFromHDF5(new Uint8Array(contents), "foobar", { lazy: true })).toThrow("not supported");
+
+    ref.free();
+    mat.free();
+    mat2.free();
+})
+
+test("writing sparse matrices to HDF5 works correctly", () => {
+    const path = dir + "/test.sparse_source.h5";
+    purge(path);
+
+    let nr = 50;
+    let nc = 300;
+    const { data, indices, indptrs } = mock_sparse_matrix(nc, nr);
+
+    let f = new hdf5.File(path, "w");
+    f.create_group("foobar");
+    f.get("foobar").create_dataset("data", data);
+    f.get("foobar").create_dataset("indices", indices);
+    f.get("foobar").create_dataset("indptr", indptrs);
+    f.get("foobar").create_dataset("shape", [nr, nc], null, "<i");
+    f.close();
+
+    var ref = scran.initializeSparseMatrixFromHDF5(path, "foobar");
+    expect(ref.isReorganized()).toBe(true);
+    let ids = ref.identities();
+
+    // Rows are written in their original order, for both formats.
+    const opath = dir + "/test.sparse_written.h5";
+    purge(opath);
+    scran.createNewHDF5File(opath);
+    scran.writeSparseMatrixToHDF5(ref, opath, "tenx", { chunkSize: 100 });
+    scran.writeSparseMatrixToHDF5(ref, opath, "h5ad", { format: "h5ad", chunkSize: 100, numberOfThreads: 2 });
+
+    let handle = new scran.H5File(opath);
+    expect(handle.children["tenx"]).toBe("Group");
+    expect(new scran.H5DataSet(opath, "tenx/data").type).toBe("Int32");
+
+    // H5AD attributes are consistent with anndata.
+    let written_h5 = new hdf5.File(opath, "r");
+    let attrs = written_h5.get("h5ad").attrs;
+    expect(attrs["encoding-type"].value).toBe("csr_matrix");
+    expect(attrs["encoding-version"].value).toBe("0.1.0");
+    expect(Array.from(attrs["shape"].value, Number)).toEqual([nc, nr]);
+    written_h5.close();
+
+    for (const name of ["tenx", "h5ad"]) {
+        var written = scran.initializeSparseMatrixFromHDF5(opath, name, { lazy: true });
+        expect(written.numberOfRows()).toBe(nr);
+        expect(written.numberOfColumns()).toBe(nc);
+        for (var r = 0; r < nr; r++) {
+            expect(compare.equalArrays(written.row(ids[r]), ref.row(r))).toBe(true);
+        }
+        written.free();
+    }
+
+    // Delayed operations are evaluated and stored as doubles.
+    var norm = scran.logNormCounts(ref);
+    scran.writeSparseMatrixToHDF5(norm, opath, "norm", { chunkSize: 100 });
+    expect(new scran.H5DataSet(opath, "norm/data").type).toBe("Float64");
+
+    var written = scran.initializeSparseMatrixFromHDF5(opath, "norm", { lazy: true });
+    for (var r = 0; r < nr; r++) {
+        expect(compare.equalFloatArrays(written.row(ids[r]), norm.row(r))).toBe(true);
+    }
+
+    expect(() => scran.writeSparseMatrixToHDF5(ref, opath, "foo", { format: "mtx" })).toThrow("unknown format");
+
+    ref.free();
+    norm.free();
+    written.free();
+})
+
+test("split initialization from HDF5 works correctly", () => {
+    const path = dir + "/test.sparse_split.h5";
+    purge(path);
+
+    let nr = 50;
+    let nc = 30;
+    const { data, indices, indptrs } = mock_sparse_matrix(nc, nr);
+
+    let f = new hdf5.File(path, "w");
+    f.create_group("foobar");
+    f.get("foobar").create_dataset("data", data);
+    f.get("foobar").create_dataset("indices", indices);
+    f.get("foobar").create_dataset("indptr", indptrs);
+    f.get("foobar").create_dataset("shape", [nr, nc], null, "<i");
+    f.close();
+
+    let modalities = [];
+    for (var r = 0; r < nr; r++) {
+        modalities.push(r % 5 == 0 ? "Antibody Capture" : (r % 7 == 0 ? null : "Gene Expression"));
+    }
+
+    let compare_split = (split, ref, expected) => {
+        let ref_ids = ref.identities();
+        let split_ids = split.identities();
+        expect(split.numberOfRows()).toBe(expected.length);
+        expect(Array.from(split_ids).sort((a, b) => a - b)).toEqual(expected);
+        for (var i = 0; i < split_ids.length; i++) {
+            let j = ref_ids.indexOf(split_ids[i]);
+            expect(compare.equalArrays(split.row(i), ref.row(j))).toBe(true);
+        }
+    };
+
+    for (const subset of [null, [1, 3, 5, 7]]) {
+        var multi = scran.initializeMultiMatrixFromHDF5(path, "foobar", modalities, { subsetColumn: subset, numberOfThreads: 2 });
+        expect(multi.available()).toEqual(["Gene Expression", "Antibody Capture"]);
+
+        for (const mod of multi.available()) {
+            let expected = [];
+            modalities.forEach((x, i) => {
+                if (x === mod) {
+                    expected.push(i);
+                }
+            });
+
+            var ref = scran.initializeSparseMatrixFromHDF5(path, "foobar", { subsetRow: expected, subsetColumn: subset });
+            compare_split(multi.get(mod), ref, expected);
+            ref.free();
+        }
+
+        multi.free();
+    }
+
+    // Also works from a buffer.
+    var multi = scran.initializeMultiMatrixFromHDF5(fs.readFileSync(path), "foobar", modalities);
+    expect(multi.numberOfColumns()).toBe(nc);
+    multi.free();
+
+    expect(() => scran.initializeMultiMatrixFromHDF5(path, "foobar", modalities.slice(1))).toThrow("number of rows");
+})
@@ -108,3 +108,20 @@ test("Log-normalization behaves with zeros", () => {
 
     mat.free();
 })
+
+test("Log-normalization gives the same results with different numbers of threads", () => {
+    var ngenes = 1000;
+    var ncells = 100;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+
+    var norm1 = scran.logNormCounts(mat, { numberOfThreads: 1 });
+    var norm2 = scran.logNormCounts(mat);
+    for (var c = 0; c < ncells; c += 10) {
+        expect(compare.equalArrays(norm1.column(c), norm2.column(c))).toBe(true);
+    }
+
+    // Cleaning up.
+    mat.free();
+    norm1.free();
+    norm2.free();
+});
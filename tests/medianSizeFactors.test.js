@@ -67,3 +67,18 @@ test("Size factor calculation works with buffering", () => {
     mat.free();
     thing.free();
 })
+
+test("Size factor calculation gives the same results with different numbers of threads", () => {
+    var ngenes = 1000;
+    var ncells = 100;
+    var mat = simulate.simulateMatrix(ngenes, ncells, 1);
+
+    var norm1 = scran.medianSizeFactors(mat, { numberOfThreads: 1 });
+    var norm2 = scran.medianSizeFactors(mat);
+    expect(compare.equalFloatArrays(norm1.array(), norm2.array())).toBe(true);
+
+    // Cleaning up.
+    mat.free();
+    norm1.free();
+    norm2.free();
+});
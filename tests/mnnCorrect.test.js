@@ -48,3 +48,19 @@ test("mnnCorrect works as expected with array inputs, presupplied buffer", () =>
     output.free();
     ref.free();
 })
+
+test("mnnCorrect gives the same results with different numbers of threads", () => {
+    var ngenes = 1000;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var pca = scran.runPCA(mat);
+
+    var output1 = scran.mnnCorrect(pca, block, { numberOfThreads: 1 });
+    var output2 = scran.mnnCorrect(pca, block);
+    expect(compare.equalFloatArrays(output1.array(), output2.array())).toBe(true);
+
+    // Mopping up.
+    mat.free();
+    pca.free();
+    output1.free();
+    output2.free();
+})
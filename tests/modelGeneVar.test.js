@@ -78,3 +78,23 @@ test("Variance modelling works as expected with blocking", () => {
 });
 
 
+
+test("Variance modelling gives the same results with different numbers of threads", () => {
+    var ngenes = 1000;
+    var ncells = 100;
+
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var norm = scran.logNormCounts(mat);
+    var res1 = scran.modelGeneVar(norm, { numberOfThreads: 1 });
+    var res2 = scran.modelGeneVar(norm);
+
+    expect(compare.equalFloatArrays(res1.means(), res2.means())).toBe(true);
+    expect(compare.equalFloatArrays(res1.variances(), res2.variances())).toBe(true);
+    expect(compare.equalFloatArrays(res1.residuals(), res2.residuals())).toBe(true);
+
+    // Cleaning up.
+    mat.free();
+    norm.free();
+    res1.free();
+    res2.free();
+});
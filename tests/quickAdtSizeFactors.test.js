@@ -36,3 +36,17 @@ test("Quick ADT size factors are computed correctly for input buffers", () => {
     buffer.free();
     buffer2.free();
 })
+
+test("Quick ADT size factors are the same with different numbers of threads", () => {
+    var ngenes = 100;
+    var ncells = 200;
+    var mat = simulate.simulateMatrix(ngenes, ncells, 1);
+
+    var buffer1 = scran.quickAdtSizeFactors(mat, { numberOfThreads: 1 });
+    var buffer2 = scran.quickAdtSizeFactors(mat);
+    expect(compare.equalFloatArrays(buffer1.array(), buffer2.array())).toBe(true);
+
+    mat.free();
+    buffer1.free();
+    buffer2.free();
+})
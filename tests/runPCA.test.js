@@ -78,3 +78,19 @@ test("PCA works as expected with blocking", () => {
 
     expect(() => scran.runPCA(mat, { features: feat, numberOfPCs: 15, block: block, blockMethod: "foobar" })).toThrow("should be one of");
 });
+
+test("PCA gives the same results with different numbers of threads", () => {
+    var ngenes = 1000;
+    var ncells = 200;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+
+    var pca1 = scran.runPCA(mat, { numberOfPCs: 10, numberOfThreads: 1 });
+    var pca2 = scran.runPCA(mat, { numberOfPCs: 10 });
+    expect(compare.equalFloatArrays(pca1.principalComponents(), pca2.principalComponents())).toBe(true);
+    expect(compare.equalFloatArrays(pca1.varianceExplained(), pca2.varianceExplained())).toBe(true);
+
+    // Mopping up.
+    mat.free();
+    pca1.free();
+    pca2.free();
+});
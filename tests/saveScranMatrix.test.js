@@ -0,0 +1,79 @@
+import * as scran from "../js/index.js";
+import * as compare from "./compare.js";
+import * as fs from "fs";
+
+const dir = "snapshot-test-files";
+if (!fs.existsSync(dir)) {
+    fs.mkdirSync(dir);
+}
+
+function purge(path) {
+    if (fs.existsSync(path)) {
+        fs.unlinkSync(path);
+    }
+}
+
+beforeAll(async () => { await scran.initialize({ localFile: true }) });
+afterAll(async () => { await scran.terminate() });
+
+test("saving and loading a layered matrix works correctly", () => {
+    var content = "%%MatrixMarket matrix coordinate integer general\n11 5 7\n1 2 5\n10 3 2\n7 4 22\n5 1 12\n6 3 2\n1 5 8\n2 2 1000000";
+    var mat = scran.initializeSparseMatrixFromMatrixMarket(new TextEncoder().encode(content));
+
+    const path = dir + "/test.scranmat";
+    purge(path);
+    scran.saveScranMatrix(mat, path);
+
+    let check = loaded => {
+        expect(loaded.numberOfRows()).toBe(mat.numberOfRows());
+        expect(loaded.numberOfColumns()).toBe(mat.numberOfColumns());
+        expect(loaded.isReorganized()).toBe(true);
+        expect(loaded.identities()).toEqual(mat.identities());
+        for (var c = 0; c < mat.numberOfColumns(); c++) {
+            expect(compare.equalArrays(loaded.column(c), mat.column(c))).toBe(true);
+        }
+    };
+
+    var loaded = scran.loadScranMatrix(path);
+    check(loaded);
+
+    // Also works from a buffer.
+    var loaded2 = scran.loadScranMatrix(fs.readFileSync(path));
+    check(loaded2);
+
+    // Fails for other files.
+    expect(() => scran.loadScranMatrix(new TextEncoder().encode(content))).toThrow("snapshot");
+
+    mat.free();
+    loaded.free();
+    loaded2.free();
+    purge(path);
+})
+
+test("saving and loading a non-layered matrix works correctly", () => {
+    // Using a dense matrix, with some rows that need larger types.
+    var vals = new Int32Array(50 * 20);
+    vals.forEach((x, i) => { vals[i] = (i % 3 == 0 ? (i % 50) * (i % 7 == 0 ? 1000 : 1) : 0); });
+    var mat = scran.initializeDenseMatrixFromDenseArray(50, 20, vals);
+    const path = dir + "/test2.scranmat";
+    purge(path);
+    scran.saveScranMatrix(mat, path, { numberOfThreads: 2 });
+
+    var loaded = scran.loadScranMatrix(path);
+    expect(loaded.numberOfRows()).toBe(50);
+    expect(loaded.numberOfColumns()).toBe(20);
+
+    let ids = (loaded.isReorganized() ? loaded.identities() : Array.from(Array(50).keys()));
+    for (var r = 0; r < 50; r++) {
+        expect(compare.equalArrays(loaded.row(r), mat.row(ids[r]))).toBe(true);
+    }
+
+    // Non-integer matrices cannot be saved.
+    var normed = scran.logNormCounts(mat);
+    expect(() => scran.saveScranMatrix(normed, path)).toThrow("non-negative integers");
+
+    mat.free();
+    loaded.free();
+    normed.free();
+    purge(path);
+})
@@ -82,3 +82,18 @@ test("scaling by neighbors works with weights", () => {
     pcs.free();
     output.free();
 })
+
+test("scaling by neighbors gives the same results with different numbers of threads", () => {
+    var ncells = 200;
+
+    var pc1 = simulate.simulatePCs(10, ncells);
+    var pc2 = simulate.simulatePCs(20, ncells);
+    let output1 = scran.scaleByNeighbors([pc1, pc2], ncells, { numberOfThreads: 1 });
+    let output2 = scran.scaleByNeighbors([pc1, pc2], ncells);
+    expect(compare.equalFloatArrays(output1.array(), output2.array())).toBe(true);
+
+    pc1.free();
+    pc2.free();
+    output1.free();
+    output2.free();
+})
@@ -84,3 +84,28 @@ test("scoreMarkers works as expected with blocking", () => {
     sub2.free();
     res2.free();
 });
+
+test("scoreMarkers gives the same results with different numbers of threads", () => {
+    var ngenes = 1000;
+    var ncells = 100;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var norm = scran.logNormCounts(mat);
+
+    var groups = [];
+    for (var i = 0; i < ncells; i++) {
+        groups.push(i % 3);
+    }
+
+    var output1 = scran.scoreMarkers(norm, groups, { numberOfThreads: 1 });
+    var output2 = scran.scoreMarkers(norm, groups);
+    for (var g = 0; g < 3; g++) {
+        expect(compare.equalFloatArrays(output1.means(g), output2.means(g))).toBe(true);
+        expect(compare.equalFloatArrays(output1.cohen(g), output2.cohen(g))).toBe(true);
+        expect(compare.equalFloatArrays(output1.auc(g), output2.auc(g))).toBe(true);
+    }
+
+    mat.free();
+    norm.free();
+    output1.free();
+    output2.free();
+});
@@ -9,3 +9,11 @@ test("wasm heap memory is reported correctly", () => {
     expect(usage > 1000).toBe(true);
     thing.free();
 })
+
+test("maximum number of threads is reported correctly", () => {
+    expect(scran.maximumThreads()).toBe(4);
+})
+
+test("memory model is reported correctly", () => {
+    expect(typeof scran.isWasm64()).toBe("boolean");
+})
@@ -0,0 +1,109 @@
+import * as scran from "../js/index.js";
+import * as compare from "./compare.js";
+import * as fs from "fs";
+
+beforeAll(async () => { await scran.initialize({ localFile: true }) });
+afterAll(async () => { await scran.terminate() });
+
+const dir = "wasm64-test-files";
+if (!fs.existsSync(dir)) {
+    fs.mkdirSync(dir);
+}
+
+function purge(path) {
+    if (fs.existsSync(path)) {
+        fs.unlinkSync(path);
+    }
+}
+
+// This runs on every build, and checks the bindings that pass offsets and
+// lengths across the Wasm boundary. In CI, it is also run against a wasm64
+// build with SCRAN_EXPECT_WASM64=1, where these would otherwise be BigInts.
+test("offsets and lengths are passed as Numbers", () => {
+    expect(scran.isWasm64()).toBe(process.env.SCRAN_EXPECT_WASM64 == "1");
+
+    let nr = 20;
+    let nc = 50;
+    let vals = new Int32Array(nr * nc);
+    vals.forEach((x, i) => { vals[i] = (i % 3 == 0 ? i % 11 : 0); });
+    let mat = scran.initializeSparseMatrixFromDenseArray(nr, nc, vals);
+    expect(mat.numberOfRows()).toBe(nr);
+    expect(mat.numberOfColumns()).toBe(nc);
+
+    // Neighbor search results report their sizes and offsets as Numbers.
+    let normed = scran.logNormCounts(mat);
+    let pcs = scran.runPCA(normed, { numberOfPCs: 5 });
+    let index = scran.buildNeighborSearchIndex(pcs);
+    let res = scran.findNearestNeighbors(index, 5);
+    expect(res.numberOfCells()).toBe(nc);
+    expect(res.size()).toBe(nc * 5);
+    let ser = res.serialize();
+    expect(ser.runs.every(x => x == 5)).toBe(true);
+
+    // Loading from buffers.
+    const path = dir + "/test.scranmat";
+    purge(path);
+    scran.saveScranMatrix(mat, path);
+    let loaded = scran.loadScranMatrix(fs.readFileSync(path));
+    expect(loaded.numberOfColumns()).toBe(nc);
+    expect(compare.equalArrays(loaded.column(1), mat.column(1))).toBe(true);
+
+    // Splitting a HDF5 matrix by modality.
+    const hpath = dir + "/test.h5";
+    purge(hpath);
+    scran.createNewHDF5File(hpath);
+    scran.writeSparseMatrixToHDF5(mat, hpath, "foobar");
+    let modalities = Array.from(Array(nr).keys()).map(i => (i % 2 ? "A" : "B"));
+    let multi = scran.initializeMultiMatrixFromHDF5(fs.readFileSync(hpath), "foobar", modalities);
+    expect(multi.get("A").numberOfRows()).toBe(nr / 2);
+    expect(multi.get("B").numberOfColumns()).toBe(nc);
+
+    mat.free();
+    normed.free();
+    pcs.free();
+    index.free();
+    res.free();
+    loaded.free();
+    multi.free();
+    purge(path);
+    purge(hpath);
+})
+
+// This requires a wasm64 build (i.e., 'build.sh main wasm64') and ~10 GB of
+// free memory, so it is only run when explicitly requested.
+const maybe = (process.env.SCRAN_TEST_WASM64 ? test : test.skip);
+
+maybe("matrices larger than 4 GB can be loaded", () => {
+    expect(scran.isWasm64()).toBe(true);
+
+    let nr = 20000;
+    let nc = 225000; // 4.5e9 elements, more than 2^32.
+    let vals = scran.createUint8WasmArray(nr * nc);
+    let arr = vals.array();
+    arr.fill(1);
+    let expected_last = 0;
+    for (var r = 0; r < nr; r++) {
+        arr[(nc - 1) * nr + r] = r % 7;
+        expected_last += r % 7;
+    }
+
+    let mat = scran.initializeDenseMatrixFromDenseArray(nr, nc, vals);
+    vals.free();
+    expect(scran.heapSize() > 2**32).toBe(true);
+
+    expect(mat.numberOfRows()).toBe(nr);
+    expect(mat.numberOfColumns()).toBe(nc);
+    let last = mat.column(nc - 1);
+    expect(last[0]).toBe(0);
+    expect(last[nr - 1]).toBe((nr - 1) % 7);
+    expect(mat.column(0).every(x => x == 1)).toBe(true);
+
+    // Computing something that needs to go through the whole matrix.
+    let sums = scran.computePerCellQCMetrics(mat, []);
+    let sf = sums.sums({ copy: false });
+    expect(sf[0]).toBe(nr);
+    expect(sf[nc - 1]).toBe(expected_last);
+
+    sums.free();
+    mat.free();
+})